@@ -0,0 +1,682 @@
+//  concurrent_mbt_map.hpp  ------------------------------------------------------------//
+
+//  Copyright Beman Dawes 2010, 2011
+
+//  Distributed under the Boost Software License, Version 1.0.
+//  http://www.boost.org/LICENSE_1_0.txt
+
+//  This library is experimental and has not been accepted as a boost.org library
+
+#ifndef BOOST_CONCURRENT_MBT_MAP_HPP
+#define BOOST_CONCURRENT_MBT_MAP_HPP
+
+#include <boost/btree/detail/mbt_base.hpp>  // for default_node_size
+#include <atomic>
+#include <thread>
+#include <type_traits>
+
+namespace boost {
+namespace btree {
+
+//--------------------------------------------------------------------------------------//
+//                                                                                      //
+//                             class concurrent_mbt_map                                 //
+//                                                                                      //
+//  "concurrent_mbt_map" is a variant of mbt_map that any number of threads may use at  //
+//  once without external locking. It uses the mbt_base node layout plus a version      //
+//  counter per node, and synchronizes via optimistic lock coupling: readers never      //
+//  lock, but validate the versions of the nodes they looked at and restart if a node   //
+//  changed; writers lock only the leaf they modify, plus the nodes taking part in a    //
+//  split.                                                                              //
+//                                                                                      //
+//  Readers may look at a node while it is being modified, so Key and T must be         //
+//  trivially copyable, and lookups return copies rather than references. Erase         //
+//  does not remove nodes; nodes are only freed by the destructor, so a reader never    //
+//  touches freed memory. There are no iterators. Nodes are allocated by Allocator,    //
+//  which must be safe to call from several threads at once.                            //
+//                                                                                      //
+//--------------------------------------------------------------------------------------//
+
+template <class Key, class T, class Compare = std::less<Key>,
+          class Allocator = std::allocator<std::pair<const Key, T> > >
+class concurrent_mbt_map
+{
+  static_assert(std::is_trivially_copyable<Key>::value,
+    "concurrent_mbt_map requires a trivially copyable Key");
+  static_assert(std::is_trivially_copyable<T>::value,
+    "concurrent_mbt_map requires a trivially copyable T");
+
+  class node;
+  class leaf_node;
+  class branch_node;
+public:
+
+  // types:
+  typedef Key                                     key_type;
+  typedef T                                       mapped_type;
+  typedef std::pair<const Key, T>                 value_type;
+  typedef Compare                                 key_compare;
+  typedef Allocator                               allocator_type;
+  typedef std::size_t                             size_type;
+
+  explicit concurrent_mbt_map(size_type node_sz = default_node_size,
+    const Compare& comp = Compare(), const Allocator& alloc = Allocator());
+
+  ~concurrent_mbt_map()  {m_free_all(m_root.load(std::memory_order_relaxed));}
+
+  // lookup and modifiers; these may be called concurrently from any number of threads
+  bool                    find(const key_type& k, mapped_type& mv) const;
+  size_type               count(const key_type& k) const;
+  bool                    insert(const value_type& x)  {return m_insert(x, false);}
+  bool                    insert_or_assign(const key_type& k, const mapped_type& mv)
+                                             {return m_insert(value_type(k, mv), true);}
+  mapped_type             operator[](const key_type& k);
+  size_type               erase(const key_type& k);
+
+  // capacity; these require that no other thread is modifying the container
+  bool                    empty() const      {return size() == 0;}
+  size_type               size() const       {return m_size(m_root.load());}
+
+  // observers:
+  key_compare             key_comp() const   {return m_key_compare;}
+  allocator_type          get_allocator() const {return m_alloc;}
+  size_type               node_size() const  {return m_node_size;}
+  int                     height() const     {return m_root.load()->height();}
+
+private:
+  concurrent_mbt_map(const concurrent_mbt_map&);             // not copyable
+  concurrent_mbt_map& operator=(const concurrent_mbt_map&);  // not assignable
+
+  typedef std::pair<Key, T>          leaf_value;
+  typedef std::pair<node*, Key>      branch_value;  // first is pointer to child node
+
+  //----------------------------------------------------------------------------------//
+  //                             private nested classes                               //
+  //----------------------------------------------------------------------------------//
+
+  //--------------------------------  class node  ------------------------------------//
+
+  class node
+  {
+  public:
+    std::atomic<boost::uint64_t>  _version;  // odd while locked by a writer
+    uint16_t        _height;                 // 0 for a leaf node; never changes
+    uint16_t        _size;
+
+    uint16_t      height() const                  {return _height;}
+    bool          is_leaf() const                 {return _height == 0;}
+    bool          is_branch() const               {return _height != 0;}
+    std::size_t   size() const                    {return _size;}
+    void          size(std::size_t n)             {_size = n;}
+
+    boost::uint64_t read_lock() const
+    // Returns: The version of an unlocked node; waits for any writer to finish.
+    {
+      boost::uint64_t v = _version.load(std::memory_order_acquire);
+      while (v & 1)
+      {
+        std::this_thread::yield();
+        v = _version.load(std::memory_order_acquire);
+      }
+      return v;
+    }
+
+    bool validate(boost::uint64_t v) const
+    // Returns: true if the node has not changed since read_lock() returned v, and
+    //          thus everything read from it since then is consistent.
+    {
+      std::atomic_thread_fence(std::memory_order_acquire);
+      return _version.load(std::memory_order_relaxed) == v;
+    }
+
+    bool try_lock(boost::uint64_t v)
+    // Effects: Locks the node for writing if it is still at version v.
+    // Returns: true if locked.
+    {
+      if (!_version.compare_exchange_strong(v, v + 1, std::memory_order_acquire))
+        return false;
+      std::atomic_thread_fence(std::memory_order_release);  // see validate()
+      return true;
+    }
+
+    void unlock()  {_version.fetch_add(1, std::memory_order_release);}
+  };
+
+  //------------------------------  class leaf_node  ---------------------------------//
+
+  class leaf_node : public node
+  {
+  public:
+    typedef typename concurrent_mbt_map::leaf_value  value_type;
+
+    leaf_value     _leaf_values[];                // actual size determined at runtime
+
+    leaf_value*    begin()                        {return _leaf_values;}
+    leaf_value*    end()                          {return _leaf_values + node::_size;}
+
+    static
+      std::size_t  extra_space()                  {return 0;}
+  };
+
+  //-----------------------------  class branch_node  --------------------------------//
+
+  class branch_node : public node
+  {
+  public:
+    typedef typename concurrent_mbt_map::branch_value  value_type;
+
+    branch_value   _branch_values[];              // actual size determined at runtime
+
+    branch_value*  begin()                        {return _branch_values;}
+    branch_value*  end()                          {return _branch_values + node::_size;}
+    // pseudo-element end()->first is valid; see mbt_base
+
+    static
+      std::size_t  extra_space()                  {return sizeof(node*);}
+  };
+
+  //----------------------------------------------------------------------------------//
+  //                              private data members                                //
+  //----------------------------------------------------------------------------------//
+
+  std::atomic<node*>    m_root;             // invariant: there is always a root
+  size_type             m_max_leaf_size;    // maximum number of elements
+  size_type             m_max_branch_size;  // maximum number of elements
+  size_type             m_node_size;
+  key_compare           m_key_compare;
+  allocator_type        m_alloc;
+
+  //----------------------------------------------------------------------------------//
+  //                           private member functions                               //
+  //----------------------------------------------------------------------------------//
+
+  template <class Node>
+  Node*     m_new_node(uint16_t height_, size_type max_elements);
+
+  // Nodes are allocated by Allocator, rebound to a type with the alignment of the node.
+  template <class Node>
+  struct node_allocation
+  {
+    typedef typename std::aligned_storage<alignof(Node), alignof(Node)>::type  unit;
+    typedef typename std::allocator_traits<Allocator>::template rebind_alloc<unit>
+                                                                   allocator_type;
+    typedef std::allocator_traits<allocator_type>                  traits;
+
+    static std::size_t units(size_type max_elements)
+    {
+      return (sizeof(Node) + Node::extra_space()
+        + max_elements * sizeof(typename Node::value_type) + sizeof(unit) - 1)
+        / sizeof(unit);
+    }
+  };
+
+  template <class Node>
+  void      m_free_node(Node* np, size_type max_elements);
+  void      m_free_all(node* np);
+  size_type m_size(node* np) const;
+
+  template <class Node>
+  static Node* node_cast(node* np) {return reinterpret_cast<Node*>(np);}
+
+  branch_value*  m_child(branch_node* bp, const key_type& k) const;
+  // Returns: The element of bp whose first is the child that k belongs on.
+
+  leaf_value*    m_leaf_lower_bound(leaf_node* lp, const key_type& k) const;
+
+  bool      m_find_leaf(const key_type& k, leaf_node*& lp, boost::uint64_t& v) const;
+  // Effects:  Descends optimistically to the leaf that k belongs on.
+  // Returns:  false if a concurrent writer interfered, and the caller must restart.
+  //           Otherwise true, with lp set to the leaf and v to its version.
+
+  bool      m_insert(const value_type& x, bool assign);
+
+  void      m_split(node* np, branch_node* parent, branch_value* parent_ep);
+  // Requires: np is full, and locked by the caller. If np is the root, parent is 0.
+  //           Otherwise parent is not full, is locked by the caller, and parent_ep
+  //           points to the element whose first is np.
+  // Effects:  Moves the upper half of np to a new node, and inserts the new node
+  //           into parent, or into a new root if np is the root.
+
+  void      m_branch_insert(branch_node* bp, branch_value* ep, const key_type& k,
+                            node* new_np);
+  // Effects:  inserts k and new_np at ep->second and (ep+1)->first, respectively
+};
+
+//--------------------------------------------------------------------------------------//
+//                                  implementation                                      //
+//--------------------------------------------------------------------------------------//
+
+//------------------------------------ constructor -------------------------------------//
+
+template <class Key, class T, class Compare, class Allocator>
+concurrent_mbt_map<Key,T,Compare,Allocator>::
+concurrent_mbt_map(size_type node_sz, const Compare& comp, const Allocator& alloc)
+  : m_node_size(node_sz), m_key_compare(comp), m_alloc(alloc)
+{
+  m_max_leaf_size = node_size() / sizeof(leaf_value);
+  m_max_branch_size = node_size() / sizeof(branch_value);
+  BOOST_ASSERT_MSG(m_max_leaf_size >= 2 && m_max_branch_size >= 2,
+    "node size too small");
+  m_root.store(m_new_node<leaf_node>(0U, m_max_leaf_size), std::memory_order_relaxed);
+}
+
+//----------------------------------  m_new_node  --------------------------------------//
+
+template <class Key, class T, class Compare, class Allocator>
+template <class Node>
+Node*
+concurrent_mbt_map<Key,T,Compare,Allocator>::
+m_new_node(uint16_t height_, size_type max_elements)
+{
+  typedef node_allocation<Node> na;
+  typename na::allocator_type alloc(m_alloc);
+  std::size_t n = na::units(max_elements);
+
+  Node* np = reinterpret_cast<Node*>(std::addressof(*na::traits::allocate(alloc, n)));
+#ifndef NDEBUG
+  std::memset(np, 0, n * sizeof(typename na::unit));
+#endif
+  ::new (&np->_version) std::atomic<boost::uint64_t>(0);
+  np->_height = height_;
+  np->size(0);
+  return np;
+}
+
+//---------------------------------  m_free_all()  -------------------------------------//
+
+template <class Key, class T, class Compare, class Allocator>
+void
+concurrent_mbt_map<Key,T,Compare,Allocator>::
+m_free_all(node* np)
+{
+  if (np->is_branch())
+  {
+    branch_node* bp = node_cast<branch_node>(np);
+    for (branch_value* it = bp->begin(); it <= bp->end(); ++it)
+      m_free_all(it->first);
+    m_free_node(bp, m_max_branch_size);
+  }
+  else
+    m_free_node(node_cast<leaf_node>(np), m_max_leaf_size);
+}
+
+//---------------------------------  m_free_node  --------------------------------------//
+
+template <class Key, class T, class Compare, class Allocator>
+template <class Node>
+void
+concurrent_mbt_map<Key,T,Compare,Allocator>::
+m_free_node(Node* np, size_type max_elements)
+{
+  // Key and T are trivially copyable, hence trivially destructible
+  typedef node_allocation<Node> na;
+  typename na::allocator_type alloc(m_alloc);
+  na::traits::deallocate(alloc,
+    std::pointer_traits<typename na::traits::pointer>::pointer_to(
+      *reinterpret_cast<typename na::unit*>(np)),
+    na::units(max_elements));
+}
+
+//----------------------------------- m_size() -----------------------------------------//
+
+template <class Key, class T, class Compare, class Allocator>
+typename concurrent_mbt_map<Key,T,Compare,Allocator>::size_type
+concurrent_mbt_map<Key,T,Compare,Allocator>::
+m_size(node* np) const
+{
+  if (np->is_leaf())
+    return np->size();
+  size_type sz = 0;
+  branch_node* bp = node_cast<branch_node>(np);
+  for (branch_value* it = bp->begin(); it <= bp->end(); ++it)
+    sz += m_size(it->first);
+  return sz;
+}
+
+//----------------------------------- m_child() ----------------------------------------//
+
+template <class Key, class T, class Compare, class Allocator>
+typename concurrent_mbt_map<Key,T,Compare,Allocator>::branch_value*
+concurrent_mbt_map<Key,T,Compare,Allocator>::
+m_child(branch_node* bp, const key_type& k) const
+{
+  // equivalent to the mbt_base unique branch search: keys equal to a branch key
+  // belong to its right child
+  branch_value* first = bp->begin();
+  std::size_t len = bp->size();
+  while (len > 0)
+  {
+    std::size_t half = len / 2;
+    if (!m_key_compare(k, (first + half)->second))
+    {
+      first += half + 1;
+      len -= half + 1;
+    }
+    else
+      len = half;
+  }
+  return first;
+}
+
+//------------------------------- m_leaf_lower_bound() ---------------------------------//
+
+template <class Key, class T, class Compare, class Allocator>
+typename concurrent_mbt_map<Key,T,Compare,Allocator>::leaf_value*
+concurrent_mbt_map<Key,T,Compare,Allocator>::
+m_leaf_lower_bound(leaf_node* lp, const key_type& k) const
+{
+  leaf_value* first = lp->begin();
+  std::size_t len = lp->size();
+  while (len > 0)
+  {
+    std::size_t half = len / 2;
+    if (m_key_compare((first + half)->first, k))
+    {
+      first += half + 1;
+      len -= half + 1;
+    }
+    else
+      len = half;
+  }
+  return first;
+}
+
+//--------------------------------- m_find_leaf() --------------------------------------//
+
+template <class Key, class T, class Compare, class Allocator>
+bool
+concurrent_mbt_map<Key,T,Compare,Allocator>::
+m_find_leaf(const key_type& k, leaf_node*& lp, boost::uint64_t& v) const
+{
+  node* np = m_root.load(std::memory_order_acquire);
+  v = np->read_lock();
+  if (np != m_root.load(std::memory_order_acquire))  // a new root was added
+    return false;
+
+  // search branches down the tree until a leaf is reached, validating each branch
+  // after the child pointer has been read from it, and again after the child's
+  // version has been read (i.e. lock coupling)
+  while (np->is_branch())
+  {
+    branch_node* bp = node_cast<branch_node>(np);
+    node* child = m_child(bp, k)->first;
+    if (!bp->validate(v))
+      return false;
+    boost::uint64_t child_v = child->read_lock();
+    if (!bp->validate(v))
+      return false;
+    np = child;
+    v = child_v;
+  }
+
+  lp = node_cast<leaf_node>(np);
+  return true;
+}
+
+//------------------------------------- find() -----------------------------------------//
+
+template <class Key, class T, class Compare, class Allocator>
+bool
+concurrent_mbt_map<Key,T,Compare,Allocator>::
+find(const key_type& k, mapped_type& mv) const
+{
+  for (;;)  // until a search completes without interference from a writer
+  {
+    leaf_node* lp;
+    boost::uint64_t v;
+    if (!m_find_leaf(k, lp, v))
+      continue;
+
+    leaf_value* it = m_leaf_lower_bound(lp, k);
+    bool found = it != lp->end() && !m_key_compare(k, it->first);
+    mapped_type result;
+    if (found)
+      result = it->second;
+
+    if (lp->validate(v))
+    {
+      if (found)
+        mv = result;
+      return found;
+    }
+  }
+}
+
+//------------------------------------ count() -----------------------------------------//
+
+template <class Key, class T, class Compare, class Allocator>
+typename concurrent_mbt_map<Key,T,Compare,Allocator>::size_type
+concurrent_mbt_map<Key,T,Compare,Allocator>::
+count(const key_type& k) const
+{
+  mapped_type mv;
+  return find(k, mv) ? 1 : 0;
+}
+
+//---------------------------------- operator[] ----------------------------------------//
+
+template <class Key, class T, class Compare, class Allocator>
+typename concurrent_mbt_map<Key,T,Compare,Allocator>::mapped_type
+concurrent_mbt_map<Key,T,Compare,Allocator>::
+operator[](const key_type& k)
+{
+  // unlike mbt_map, a copy is returned; a concurrent split may move the element
+  mapped_type mv;
+  while (!find(k, mv))  // loops only if another thread erases k in between
+    insert(value_type(k, mapped_type()));
+  return mv;
+}
+
+//------------------------------------- erase() ----------------------------------------//
+
+template <class Key, class T, class Compare, class Allocator>
+typename concurrent_mbt_map<Key,T,Compare,Allocator>::size_type
+concurrent_mbt_map<Key,T,Compare,Allocator>::
+erase(const key_type& k)
+{
+  for (;;)  // until an erase completes without interference from a writer
+  {
+    leaf_node* lp;
+    boost::uint64_t v;
+    if (!m_find_leaf(k, lp, v))
+      continue;
+
+    leaf_value* it = m_leaf_lower_bound(lp, k);
+    if (it == lp->end() || m_key_compare(k, it->first))
+    {
+      if (lp->validate(v))
+        return 0;
+      continue;
+    }
+
+    if (!lp->try_lock(v))  // lp changed since the search, so it may be stale
+      continue;
+    std::move(it+1, lp->end(), it);
+    lp->size(lp->size()-1);
+    lp->unlock();
+    return 1;
+  }
+}
+
+//------------------------------------ m_insert() --------------------------------------//
+
+template <class Key, class T, class Compare, class Allocator>
+bool
+concurrent_mbt_map<Key,T,Compare,Allocator>::
+m_insert(const value_type& x, bool assign)
+{
+  for (;;)  // until an insert completes without interference from a writer
+  {
+    node* np = m_root.load(std::memory_order_acquire);
+    boost::uint64_t v = np->read_lock();
+    if (np != m_root.load(std::memory_order_acquire))
+      continue;
+
+    branch_node*     parent = 0;
+    branch_value*    parent_ep = 0;
+    boost::uint64_t  parent_v = 0;
+    bool             restart = false;
+
+    // search branches down the tree, splitting any full branch on the way so that
+    // a later split always finds room in its parent
+    while (np->is_branch())
+    {
+      branch_node* bp = node_cast<branch_node>(np);
+
+      if (bp->size() == m_max_branch_size)
+      {
+        if (parent && !parent->try_lock(parent_v))
+          { restart = true; break; }
+        if (!bp->try_lock(v))
+        {
+          if (parent)
+            parent->unlock();
+          restart = true;
+          break;
+        }
+        m_split(bp, parent, parent_ep);
+        bp->unlock();
+        if (parent)
+          parent->unlock();
+        restart = true;  // the path has changed, so search again
+        break;
+      }
+
+      branch_value* ep = m_child(bp, x.first);
+      node* child = ep->first;
+      if (!bp->validate(v))
+        { restart = true; break; }
+      boost::uint64_t child_v = child->read_lock();
+      if (!bp->validate(v))
+        { restart = true; break; }
+
+      parent = bp;
+      parent_ep = ep;
+      parent_v = v;
+      np = child;
+      v = child_v;
+    }
+    if (restart)
+      continue;
+
+    leaf_node* lp = node_cast<leaf_node>(np);
+    leaf_value* it = m_leaf_lower_bound(lp, x.first);
+
+    if (it != lp->end() && !m_key_compare(x.first, it->first))  // already present
+    {
+      if (!assign)
+      {
+        if (lp->validate(v))
+          return false;
+        continue;
+      }
+      if (!lp->try_lock(v))
+        continue;
+      it->second = x.second;
+      lp->unlock();
+      return false;
+    }
+
+    if (lp->size() == m_max_leaf_size)  // if no room on node, node must be split
+    {
+      if (parent && !parent->try_lock(parent_v))
+        continue;
+      if (!lp->try_lock(v))
+      {
+        if (parent)
+          parent->unlock();
+        continue;
+      }
+      m_split(lp, parent, parent_ep);
+      lp->unlock();
+      if (parent)
+        parent->unlock();
+      continue;  // the insert point may now be on the new node, so search again
+    }
+
+    if (!lp->try_lock(v))
+      continue;
+    std::move_backward(it, lp->end(), lp->end()+1);
+    *it = leaf_value(x.first, x.second);
+    lp->size(lp->size()+1);
+    lp->unlock();
+    return true;
+  }
+}
+
+//------------------------------------- m_split() --------------------------------------//
+
+template <class Key, class T, class Compare, class Allocator>
+void
+concurrent_mbt_map<Key,T,Compare,Allocator>::
+m_split(node* np, branch_node* parent, branch_value* parent_ep)
+{
+  node* new_np;
+  key_type k;
+
+  if (np->is_leaf())
+  {
+    // split leaf by moving half the elements to the new leaf
+    leaf_node* lp = node_cast<leaf_node>(np);
+    leaf_node* new_lp = m_new_node<leaf_node>(0U, m_max_leaf_size);
+    new_lp->size(lp->size() / 2);
+    std::copy(lp->end() - new_lp->size(), lp->end(), new_lp->begin());
+    lp->size(lp->size() - new_lp->size());
+    k = new_lp->begin()->first;
+    new_np = new_lp;
+  }
+  else
+  {
+    // split branch by moving half the elements to the new branch; the key between
+    // the two halves is promoted to the parent
+    branch_node* bp = node_cast<branch_node>(np);
+    branch_node* new_bp = m_new_node<branch_node>(bp->height(), m_max_branch_size);
+    new_bp->size(bp->size() / 2);
+    std::copy(bp->end() - new_bp->size(), bp->end(), new_bp->begin());
+    new_bp->end()->first = bp->end()->first;  // copy the end pseudo-element
+    bp->size(bp->size() - (new_bp->size()+1));
+    k = bp->end()->second;
+    new_np = new_bp;
+  }
+
+  if (parent)
+  {
+    m_branch_insert(parent, parent_ep, k, new_np);
+    return;
+  }
+
+  // np is the root, so create a new root containing only the end pseudo-element;
+  // the old root remains locked until it has been replaced
+  branch_node* new_root
+    = m_new_node<branch_node>(np->height()+1, m_max_branch_size);
+  new_root->begin()->first = np;
+  m_branch_insert(new_root, new_root->begin(), k, new_np);
+  m_root.store(new_root, std::memory_order_release);
+}
+
+//------------------------------- m_branch_insert() ------------------------------------//
+
+template <class Key, class T, class Compare, class Allocator>
+void
+concurrent_mbt_map<Key,T,Compare,Allocator>::
+m_branch_insert(branch_node* bp, branch_value* ep, const key_type& k, node* new_np)
+{
+  BOOST_ASSERT(bp->size() < m_max_branch_size);
+
+  // make room for insert
+  (bp->end()+1)->first = bp->end()->first;  // end pseudo-element
+  if (ep != bp->end())
+  {
+    std::move_backward(ep+1, bp->end(), bp->end()+1);
+    (ep+1)->second = ep->second;  // key
+  }
+
+  ep->second = k;
+  (ep+1)->first = new_np;
+  bp->size(bp->size()+1);
+}
+
+}  // namespace btree
+}  // namespace boost
+
+#endif  // BOOST_CONCURRENT_MBT_MAP_HPP
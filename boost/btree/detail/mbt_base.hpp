@@ -28,13 +28,39 @@
 #include <new>
 #include <iterator>
 #include <algorithm>
+#include <limits>
 #include <ostream>
 #include <stdexcept>
 #include <boost/cstdint.hpp>
 #include <boost/iterator/iterator_facade.hpp>
 #include <boost/assert.hpp>
 #include <boost/btree/detail/placement_move.hpp>
+#include <boost/btree/detail/simd_search.hpp>
+#include <boost/btree/detail/node_search.hpp>
 #include <cstring> // for memset
+#include <type_traits>
+#include <vector>
+#include <atomic>
+
+//  Copy construction and copy assignment of large trees clone the subtrees of the root
+//  in parallel, unless BOOST_BTREE_NO_PARALLEL_CLONE is defined
+#if !defined(BOOST_BTREE_NO_PARALLEL_CLONE) && defined(BOOST_HAS_THREADS) \
+  && !defined(BOOST_NO_CXX11_HDR_FUTURE)
+# define BOOST_BTREE_PARALLEL_CLONE
+# include <future>
+# include <thread>
+# include <vector>
+# include <exception>
+#endif
+
+//  std::pmr aliases for the containers are provided if <memory_resource> is available,
+//  unless BOOST_BTREE_NO_PMR is defined
+#if !defined(BOOST_BTREE_NO_PMR) && defined(__has_include) && __cplusplus >= 201703L
+# if __has_include(<memory_resource>)
+#   define BOOST_BTREE_HAS_PMR
+#   include <memory_resource>
+# endif
+#endif
 
 
 /*
@@ -49,16 +75,109 @@ TODO:
   * Tighten requirements on Key and T to match standard library.
     Change archetype accordingly.
 
-  * Should use allocators, allocator_traits!
-
   * Review exception safety.
 
 */
 
 namespace boost {
+namespace detail {
+
+  template <class Monoid>
+  struct monoid_result  {typedef typename Monoid::result_type type;};
+  template <>
+  struct monoid_result<void>  {typedef void type;};
+
+}  // namespace detail
+
 namespace btree {
 
   const std::size_t default_node_size = 2048;
+  const double default_fill_factor = 1.0;  // fraction of a node filled by bulk_load()
+  const double default_min_fill = 0.25;    // see mbt_base::min_fill()
+  const std::size_t parallel_clone_min_size = 100000;  // elements; see m_clone_tree()
+  const std::size_t find_batch_group = 16;  // keys descending together; see find_batch()
+
+  //  Search policies, chosen by the Search template parameter of the containers. Each
+  //  selects how a node is searched during a descent.
+
+  struct standard_search {};    // std::lower_bound and std::upper_bound
+  struct branchless_search {};  // a binary search without data dependent branches,
+                                //   finishing with SIMD compares for integral keys
+  struct eytzinger_search {};   // as branchless_search for leaves; each branch also
+                                //   keeps a copy of its keys in Eytzinger order. Key
+                                //   must be trivially copyable.
+
+  //  Order statistic policies, chosen by the Stats template parameter of the containers.
+
+  struct no_order_statistics {typedef void monoid;};
+  struct order_statistics {typedef void monoid;};
+                                // each branch also keeps the number of elements under
+                                //   each child, so rank(), select(), index_of() and
+                                //   count() take O(log n), at some cost to inserts
+                                //   and erases
+  template <class Monoid>
+  struct aggregate_statistics : order_statistics {typedef Monoid monoid;};
+                                // as order_statistics, and each branch also keeps
+                                //   Monoid's summary of the elements under each
+                                //   child, so range_aggregate() takes O(log n).
+                                //   Inserts and erases recompute the summaries on
+                                //   their path.
+
+  //  A Monoid for aggregate_statistics is a default constructible type with:
+  //
+  //    typedef unspecified result_type;  // trivially copyable
+  //    result_type identity() const;
+  //    result_type element(const value_type& x) const;  // the summary of x alone
+  //    result_type combine(const result_type& a, const result_type& b) const;
+  //
+  //  combine() must be associative, with identity() as its identity element. Summaries
+  //  are combined in key order, so combine() need not be commutative.
+
+  struct element_value  // a map element's mapped value, or a set's element
+  {
+    template <class K, class T>
+    const T& operator()(const std::pair<const K, T>& x) const  {return x.second;}
+    template <class T>
+    const T& operator()(const T& x) const                      {return x;}
+  };
+
+  template <class T, class Value = element_value>
+  struct sum_aggregate
+  {
+    typedef T result_type;
+    T identity() const                         {return T();}
+    template <class V>
+    T element(const V& x) const                {return Value()(x);}
+    T combine(const T& a, const T& b) const    {return a + b;}
+  };
+
+  template <class T, class Value = element_value>
+  struct min_aggregate
+  {
+    typedef T result_type;
+    T identity() const
+    {
+      return std::numeric_limits<T>::has_infinity
+        ? std::numeric_limits<T>::infinity() : (std::numeric_limits<T>::max)();
+    }
+    template <class V>
+    T element(const V& x) const                {return Value()(x);}
+    T combine(const T& a, const T& b) const    {return b < a ? b : a;}
+  };
+
+  template <class T, class Value = element_value>
+  struct max_aggregate
+  {
+    typedef T result_type;
+    T identity() const
+    {
+      return std::numeric_limits<T>::has_infinity
+        ? -std::numeric_limits<T>::infinity() : std::numeric_limits<T>::lowest();
+    }
+    template <class V>
+    T element(const V& x) const                {return Value()(x);}
+    T combine(const T& a, const T& b) const    {return a < b ? b : a;}
+  };
 
 //--------------------------------------------------------------------------------------//
 //                                  class mbt_base                                      //
@@ -81,6 +200,11 @@ public:
   typedef Compare                                 key_compare;
   typedef typename Base::value_compare            value_compare;
   typedef Allocator                               allocator_type;
+  typedef typename Base::search_policy            search_policy;
+  typedef typename Base::statistics_policy        statistics_policy;
+  typedef typename statistics_policy::monoid      monoid_type;     // or void
+  typedef typename detail::monoid_result<monoid_type>::type
+                                                  aggregate_type;  // or void
   typedef value_type&                             reference;
   typedef const value_type&                       const_reference;
   typedef iterator_type<typename Base::iterator_value_type>
@@ -116,7 +240,7 @@ public:
 //  mbt_base(initializer_list<value_type>, const Compare& = Compare(),
 //    const Allocator& = Allocator());
 
-  ~mbt_base()  {m_free_all(m_root);}
+  ~mbt_base()  {m_release_all();}
 
   mbt_base<Key,Base,Compare,Allocator>&
     operator=(const mbt_base<Key,Base,Compare,Allocator>& x);  // copy assignment
@@ -148,35 +272,98 @@ public:
   //template <class... Args>
   //  std::pair<iterator, bool>
   //                        emplace(Args&&... args);
-  //template <class... Args>
-  //  iterator              emplace_hint(const_iterator position, Args&&... args);
 
 //    template <class P>
 //      std::pair<iterator, bool>
 //                            insert(P&& x);
-//    iterator                insert(const_iterator position, const value_type& x);
-//    template <class P>
-//      iterator              insert(const_iterator position, P&&);
 //    void                    insert(initializer_list<value_type>);
 
   iterator                erase(const_iterator position);
   size_type               erase(const key_type& x);
   iterator                erase(const_iterator first, const_iterator last);
+  // Complexity: O(log n) plus the number of nodes freed. Only the leaves holding first
+  //           and last have elements moved; the leaves and branches between them are
+  //           freed whole.
+  size_type               erase_before(const key_type& x);
+  // Effects:  Erases the elements whose keys are less than x.
+  // Returns:  The number of elements erased.
+  size_type               erase_after(const key_type& x);
+  // Effects:  Erases the elements whose keys are greater than x.
+  // Returns:  The number of elements erased.
+  void                    split_at(const key_type& x,
+                                   mbt_base<Key,Base,Compare,Allocator>& tail);
+  // Effects:  Replaces the contents of tail with the elements of *this whose keys are
+  //           not less than x, removing them from *this.
+  // Remarks:  Invalidates all iterators into either container.
+  // Complexity: If tail has the same node_size() and an equal allocator, O(log n):
+  //           the tree is cut along the path to x, the subtrees on either side of the
+  //           path change containers whole, and only the leaf holding the cut has
+  //           elements moved. The branches of whichever part has fewer children at
+  //           its root are then visited to tally node_count(), and without
+  //           order_statistics its leaves too, to count its elements. Otherwise,
+  //           linear in the number of elements moved.
+  void                    join(mbt_base<Key,Base,Compare,Allocator>& tail);
+  // Requires: Each element of tail belongs after every element of *this; in unique
+  //           containers, its key is greater than theirs.
+  // Effects:  Moves the elements of tail to the end of *this, leaving tail empty.
+  // Remarks:  Invalidates all iterators into either container.
+  // Complexity: If tail has the same node_size() and an equal allocator, O(log n)
+  //           plus the number of tail's free nodes: the shorter tree is grafted whole
+  //           onto the edge of the taller, at its own height. Otherwise, linear in
+  //           tail.size().
   void                    swap(mbt_base<Key,Base,Compare,Allocator>&x);
   void                    clear() BOOST_NOEXCEPT;
 
+  template <class InputIterator>
+  void                    bulk_load(InputIterator first, InputIterator last,
+                                    double fill_factor = default_fill_factor);
+  // Effects:  As if each element of [first, last) were inserted. However, if the
+  //           container is empty, the tree is built bottom-up while the elements
+  //           arrive in order, filling each node to fill_factor of its capacity.
+  //           Any elements from the first out-of-order element on are inserted
+  //           normally.
+  // Complexity: Linear, if the container is empty and [first, last) is sorted.
+
+  size_type               compact(double fill_factor = default_fill_factor);
+  // Effects:  In one pass over the leaves, moves elements toward the first leaf so
+  //           that every leaf but the last holds at least fill_factor of its capacity,
+  //           then rebuilds the branches filled to fill_factor. Leaves that end up
+  //           empty are freed, and storage that no longer holds any node is returned to
+  //           the allocator.
+  // Returns:  The number of bytes returned to the allocator.
+  // Remarks:  Invalidates all iterators. Leaves already fuller than fill_factor are
+  //           left as they are.
+  // Complexity: Linear.
+  size_type               shrink_to_fit();
+  // Effects:  As if compact(), but also moves all nodes to storage just large enough
+  //           to hold them, so all free storage is returned to the allocator.
+  // Returns:  The number of bytes returned to the allocator.
+  // Remarks:  Invalidates all iterators.
+  // Complexity: Linear.
+
   // observers:
   key_compare             key_comp() const   {return m_key_compare;}
   value_compare           value_comp() const {return m_value_compare;}
   allocator_type          get_allocator() const BOOST_NOEXCEPT {return m_alloc;}
   size_type               node_size() const BOOST_NOEXCEPT {return m_node_size;}
   int                     height() const     {return m_root->height();}  // aids testing, tuning
+  size_type               node_count() const {return m_pool.nodes;}       // ditto
+  double                  min_fill() const   {return m_min_fill;}
+  void                    min_fill(double f);
+  // Requires: f >= 0.0 && f <= 0.5
+  // Effects:  When erase() leaves a node other than the root with fewer elements than
+  //           f of its capacity, the node borrows elements from an adjacent sibling,
+  //           or if both fit in one node, merges with it. If f is 0.0, nodes are only
+  //           removed once empty.
+  // Remarks:  The default, default_min_fill, is well below half so that a merge isn't
+  //           promptly undone by a split when inserts and erases alternate.
   void                    dump_dot(std::ostream& os) const;
 
   // 23.4.4.5, map operations:
   iterator                find(const key_type& x);
   const_iterator          find(const key_type& x) const {return const_cast<mbt_base*>(this)->find(x);}
   size_type               count(const key_type& x) const;
+  // Complexity: O(log n) with order_statistics, otherwise O(log n) plus the count.
   iterator                lower_bound(const key_type& x);
   const_iterator          lower_bound(const key_type& x) const {return const_cast<mbt_base*>(this)->lower_bound(x);}
   iterator                upper_bound(const key_type& x);
@@ -186,6 +373,71 @@ public:
   std::pair<const_iterator, const_iterator>
                           equal_range(const key_type& x) const {return std::make_pair(lower_bound(x), upper_bound(x));}
 
+  template <class ForwardIterator, class OutputIterator>
+  OutputIterator          find_batch(ForwardIterator first, ForwardIterator last,
+                            OutputIterator result);
+  template <class ForwardIterator, class OutputIterator>
+  OutputIterator          find_batch(ForwardIterator first, ForwardIterator last,
+                            OutputIterator result) const
+                            {return const_cast<mbt_base*>(this)->find_batch(first, last, result);}
+  // Effects:  For each key k in [first, last), in order, *result++ = find(k).
+  // Returns:  result.
+  // Remarks:  The keys are looked up in groups of find_batch_group, whose descents
+  //           proceed a level at a time, each prefetching the child it picks before
+  //           the next key's search. The cache misses of the group thus overlap,
+  //           where a loop calling find() would wait on each in turn.
+
+  //  Order statistics; each requires order_statistics or aggregate_statistics.
+  size_type               rank(const key_type& x) const;
+  // Returns:  The number of elements with keys less than x, i.e. the index of
+  //           lower_bound(x). rank(y) - rank(x) is the size of the range [x, y).
+  // Complexity: O(log n).
+  iterator                select(size_type i);
+  const_iterator          select(size_type i) const {return const_cast<mbt_base*>(this)->select(i);}
+  // Returns:  The iterator i positions after begin(), or end() if i >= size().
+  // Complexity: O(log n).
+  size_type               index_of(const_iterator pos) const;
+  // Returns:  std::distance(begin(), pos). select(index_of(pos) + n) thus advances
+  //           pos by n in O(log n).
+  // Complexity: O(log n), plus, in non-unique containers, the number of leaves
+  //           holding elements equivalent to *pos that precede it.
+
+  //  Aggregates; each requires aggregate_statistics.
+  aggregate_type          range_aggregate(const key_type& lo, const key_type& hi) const;
+  // Returns:  The combined summaries, in order, of the elements with keys not less
+  //           than lo and less than hi; identity() if there are none.
+  aggregate_type          range_aggregate(const_iterator first, const_iterator last) const;
+  // Returns:  The combined summaries, in order, of the elements of [first, last).
+  aggregate_type          aggregate() const  {return range_aggregate(begin(), end());}
+  // Complexity: O(log n), as only the branches and leaves at the ends of the range
+  //           are visited; the summaries of the subtrees between are already combined.
+  void                    update_aggregates(const_iterator pos);
+  // Effects:  Recomputes the summaries covering pos.
+  // Remarks:  Call it after changing the mapped value of an element through an
+  //           iterator or operator[], since the summaries can't see that change.
+  // Complexity: O(log n).
+
+  //  A cursor remembers the leaf it last reached, and the branches above it, so that a
+  //  seek near the previous one climbs only as far as the keys it passes, and descends
+  //  from there. Seeks at distance d apart thus cost O(log d) rather than O(log n),
+  //  which suits local access patterns, merge joins, and galloping searches.
+  class cursor
+  {
+  public:
+    explicit cursor(mbt_base& c) : m_container(&c)  {reset();}
+
+    iterator  seek(const key_type& k);
+    // Returns:  lower_bound(k).
+    void      reset();
+    // Effects:  Positions the cursor at the first leaf.
+    // Remarks:  Modifying the container invalidates a cursor until reset() is called.
+
+  private:
+    mbt_base*                  m_container;
+    leaf_node*                 m_leaf;
+    std::vector<branch_node*>  m_path;  // m_path[h] is m_leaf's ancestor of height h
+  };
+
 private:
 
   friend class node;
@@ -193,38 +445,22 @@ private:
   typedef typename Base::non_unique  non_unique;
   typedef typename Base::uniqueness  uniqueness;
   typedef typename Base::leaf_value  leaf_value;
-  typedef std::pair<node*, Key>      branch_value;  // first is pointer to child node
+  typedef std::is_same<search_policy, eytzinger_search>  eytzinger_branches;
+  typedef std::is_base_of<order_statistics, statistics_policy>  counted_branches;
+  typedef std::integral_constant<bool, !std::is_void<monoid_type>::value>
+                                                          aggregated_branches;
+
+  static_assert(!aggregated_branches::value
+    || std::is_trivially_copyable<aggregate_type>::value,
+    "aggregate_statistics requires a trivially copyable Monoid::result_type");
+
+  static_assert(!eytzinger_branches::value || std::is_trivially_copyable<Key>::value,
+    "eytzinger_search requires a trivially copyable Key");
 
   //----------------------------------------------------------------------------------//
   //                             private nested classes                               //
   //----------------------------------------------------------------------------------//
 
-  //-------------------------  class branch_value_compare  ---------------------------//
-
-  class branch_value_compare
-  {
-    friend class mbt_base;
-  protected:
-    Compare comp;
-    branch_value_compare(Compare c) : comp(c) {}
-  public:
-    typedef bool                                  result_type;
-    typedef value_type                            first_argument_type;
-    typedef value_type                            second_argument_type;
-    bool operator()(const branch_value& x, const branch_value& y) const
-    {
-      return comp(x.second, y.second);
-    }
-    bool operator()(const Key& k, const branch_value& y) const
-    {
-      return comp(k, y.second);
-    }
-    bool operator()(const branch_value& x, const Key& k) const
-    {
-      return comp(x.second, k);
-    }
-  };
-
   //--------------------------------  class node  ------------------------------------//
 
   class node
@@ -233,12 +469,8 @@ private:
   public:
     uint16_t        _height;          // 0 for a leaf node
     uint16_t        _size;
+    uint16_t        _parent_index;    // index of this node among its parent's children
     branch_node*    _parent_node;     // 0 for the root node
-    union
-    {
-      branch_value* _parent_element;  // non-root node
-      mbt_base*      _owner;           // root node
-    };
 
     uint16_t      height() const                  {return _height;}
     bool          is_leaf() const                 {return _height == 0;}
@@ -247,22 +479,19 @@ private:
     bool          is_empty() const                {return _size == 0;}
     std::size_t   size() const                    {return _size;}
     branch_node*  parent_node() const             {return _parent_node;}
-    branch_value* parent_element() const          {return _parent_element;}
-    mbt_base*      owner() const                   {return _owner;}
+    std::size_t   parent_index() const            {return _parent_index;}
 
     void          height(uint16_t h)              {_height = h;}
     void          size(std::size_t n)             {_size = n;}
     void          parent_node(branch_node* p)     {_parent_node = p;}
-    void          parent_element(branch_value* p) {_parent_element = p;}
-    void          owner(mbt_base* o)               {_owner = o;}
+    void          parent_index(std::size_t i)     {_parent_index = static_cast<uint16_t>(i);}
 
-    // GCC 4.5.2 only worked on these functions when the type was deduced - thus the
+    // GCC 4.5.2 only worked on this function when the type was deduced - thus the
     // unused function argument
     template <class Node>
     Node* next_node(Node*);  // returns next node at same height; root node if end
-
-    template <class Node>
-    Node* prior_node(Node*);  // returns prior node at same height; root node if end
+    // Remarks: Climbs the child->parent list, so is only used by modifiers that have
+    //          just created that list. Iteration uses the leaf sibling links instead.
   };
 
   //------------------------------  class leaf_node  ---------------------------------//
@@ -273,34 +502,168 @@ private:
     typedef typename mbt_base::leaf_value   value_type;
     typedef typename mbt_base::mapped_type  mapped_type;
 
+    leaf_node*     _prior_leaf;                   // 0 for the first leaf
+    leaf_node*     _next_leaf;                    // 0 for the last leaf
+    mbt_base*      _owner;                        // valid only for the last leaf
     leaf_value     _leaf_values[];                // actual size determined at runtime
 
     leaf_value*    begin()                        {return _leaf_values;}
     leaf_value*    end()                          {return _leaf_values + node::_size;}
 
+    leaf_node*     prior_leaf() const             {return _prior_leaf;}
+    leaf_node*     next_leaf() const              {return _next_leaf;}
+    mbt_base*      owner() const                  {return _owner;}
+    void           owner(mbt_base* o)             {_owner = o;}
+
+    void           init(std::size_t)              {}
     static
-      std::size_t  extra_space()                  {return 0;}
+      std::size_t  extra_space(std::size_t)       {return 0;}
     };
 
   //-----------------------------  class branch_node  --------------------------------//
 
+  //  Keys and child pointers are kept in separate arrays, so a search, which compares
+  //  only keys, touches only the cache lines holding keys. The keys follow the header;
+  //  the child pointers follow room for the node's maximum number of keys.
+  //
+  //  With eytzinger_search, the sorted keys are followed, after the child pointers, by
+  //  the sorted position of each key in Eytzinger order, then by the keys themselves in
+  //  that order, starting on a cache line so that a prefetch covers whole levels of the
+  //  implicit tree. Searches use only the Eytzinger arrays; everything else uses the
+  //  sorted keys, and m_reindex() rebuilds the Eytzinger arrays from them.
+  //
+  //  With order_statistics, each child pointer is paired with the number of elements
+  //  in the child's subtree, so moving a child moves its count along with it. With
+  //  aggregate_statistics, the summary of those elements is paired with it too.
+
+  struct counted_child
+  {
+    node*      ptr;
+    size_type  count;
+  };
+  typedef typename std::conditional<aggregated_branches::value, aggregate_type,
+    char>::type  slot_aggregate;  // never void, so aggregate() can be declared
+
+  struct aggregated_child : counted_child
+  {
+    slot_aggregate  aggregate;
+  };
+  typedef typename std::conditional<aggregated_branches::value, aggregated_child,
+    typename std::conditional<counted_branches::value, counted_child, node*>::type
+    >::type  child_slot;
+
+  static node*&  slot_ptr(node*& s)          {return s;}
+  static node*&  slot_ptr(counted_child& s)  {return s.ptr;}
+
   class branch_node : public node
   {
   public:
-    typedef typename mbt_base::branch_value  value_type;
-    typedef node*                           mapped_type;
+    typedef typename mbt_base::key_type      value_type;
+
+    child_slot*    _children;                     // size() + 1 are valid
+    key_type       _keys[];                       // actual size determined at runtime
+
+    key_type*      begin()                        {return _keys;}
+    key_type*      end()                          {return _keys + node::_size;}
+    key_type&      key(std::size_t i)             {return _keys[i];}
+    child_slot*    children()                     {return _children;}
+    node*&         child(std::size_t i)           {return slot_ptr(_children[i]);}
+    // child(size()) is valid; b-tree branches have size() + 1 child pointers - see
+    // your favorite computer science textbook. key(i) separates child(i) from
+    // child(i+1).
+    size_type&     count(std::size_t i)           {return _children[i].count;}
+    // Requires: counted_branches::value.
+    // Returns: The number of elements in the subtree of child(i).
+    slot_aggregate& aggregate(std::size_t i)      {return _children[i].aggregate;}
+    // Requires: aggregated_branches::value.
+    // Returns: The combined summaries of the elements in the subtree of child(i).
+
+    void           init(std::size_t max_elements)
+      {_children = reinterpret_cast<child_slot*>(reinterpret_cast<char*>(this)
+        + children_offset(max_elements));}
+    uint16_t*      eytzinger_ranks(std::size_t max_elements)
+      {return reinterpret_cast<uint16_t*>(_children + max_elements + 1);}
+    key_type*      eytzinger_keys(std::size_t max_elements)
+      {
+        std::size_t p = reinterpret_cast<std::size_t>(
+          eytzinger_ranks(max_elements) + max_elements + 1);
+        return reinterpret_cast<key_type*>(
+          (p + eytzinger_align - 1) / eytzinger_align * eytzinger_align);
+      }
+    // Requires: eytzinger_branches::value. max_elements is the node's maximum size.
+    // Remarks:  Both arrays are one-based; see detail::eytzinger_fill().
+
+    static const std::size_t eytzinger_align
+      = alignof(key_type) > 64 ? alignof(key_type) : 64;
+
+    static
+      std::size_t  extra_space(std::size_t max_elements)
+      {
+        return children_offset(max_elements) - sizeof(branch_node)
+          - max_elements * sizeof(key_type) + (max_elements + 1) * sizeof(child_slot)
+          + (eytzinger_branches::value ? (max_elements + 1)
+              * (sizeof(uint16_t) + sizeof(key_type)) + eytzinger_align - 1 : 0);
+      }
+    static
+      std::size_t  children_offset(std::size_t max_elements)
+      {
+        return (sizeof(branch_node) + max_elements * sizeof(key_type)
+          + alignof(child_slot) - 1) / alignof(child_slot) * alignof(child_slot);
+      }
+  };
+
+  //-------------------------------  struct node_pool  -------------------------------//
 
-    branch_value   _branch_values[];              // actual size determined at runtime
+  //  Nodes are carved from slabs obtained from the allocator, and freed nodes go on a
+  //  free list for their kind, so creating and freeing nodes rarely reaches the
+  //  allocator. Slabs are only returned to the allocator all at once.
+  //
+  //  split_at() hands subtrees to another container without moving them, so after it
+  //  each container may hold nodes in the other's slabs. The slabs of the container
+  //  split then become a shared list, recorded by its first slab in the shared
+  //  slabs of both pools; that slab counts the pools holding the list, and the last
+  //  to release it returns the list to the allocator. A pool only trims its own slabs.
 
-    branch_value*  begin()                        {return _branch_values;}
-    branch_value*  end()                          {return _branch_values + node::_size;}
-    // pseudo-element end()->first is valid; b-tree branches have size() + 1
-    // child pointers - see your favorite computer science textbook.
+  static const std::size_t  pool_align = alignof(leaf_node) > alignof(branch_node)
+                                           ? alignof(leaf_node) : alignof(branch_node);
+  typedef typename std::aligned_storage<pool_align, pool_align>::type  pool_unit;
 
-    static
-      std::size_t  extra_space()                  {return sizeof(node*);}
+  struct slab
+  {
+    slab*          next;
+    std::size_t    units;                         // size, including this header
+    std::size_t    carved;                        // units handed out, once not active
+    std::atomic<std::size_t> owners;              // pools holding the list, if shared
+  };
+
+  struct node_pool
+  {
+    slab*          slabs;                         // obtained from the allocator
+    slab*          active;                        // the slab nodes are carved from
+    char*          next;                          // unused space in the active slab
+    char*          end;
+    node*          free_leaves;                   // free lists are linked through
+    node*          free_branches;                 //   the first bytes of each node
+    std::size_t    bytes;                         // total size of slabs, shared too
+    std::size_t    nodes;                         // in use
+    std::vector<slab*>  shared;                   // first slabs of shared lists
+
+    node_pool() : slabs(0), active(0), next(0), end(0), free_leaves(0),
+      free_branches(0), bytes(0), nodes(0) {}
+
+    void deactivate()  // record how much of the active slab has been carved
+    {
+      if (active)
+        active->carved = (next - reinterpret_cast<char*>(active)) / sizeof(pool_unit);
+      active = 0;
+      next = end = 0;
+    }
   };
 
+  typedef typename std::allocator_traits<Allocator>::template rebind_alloc<pool_unit>
+                                                                       pool_allocator;
+  typedef std::allocator_traits<pool_allocator>                        pool_traits;
+
   //----------------------------------------------------------------------------------//
   //                                  iterator_type                                   //
   //----------------------------------------------------------------------------------//
@@ -365,11 +728,16 @@ private:
   size_type             m_size;             // number of elements in container
   size_type             m_max_leaf_size;    // maximum number of elements
   size_type             m_max_branch_size;  // maximum number of elements
+  size_type             m_min_leaf_size;    // rebalance on erase below this
+  size_type             m_min_branch_size;  // rebalance on erase below this
   node*                 m_root;             // invariant: there is always a root
+  leaf_node*            m_first_leaf;       // head of the leaf sibling list
+  leaf_node*            m_last_leaf;        // tail of the leaf sibling list
+  node_pool             m_pool;             // storage for nodes
   size_type             m_node_size;
+  double                m_min_fill;
   key_compare           m_key_compare;
   value_compare         m_value_compare;
-  branch_value_compare  m_branch_value_compare;
   allocator_type        m_alloc;
 
   //----------------------------------------------------------------------------------//
@@ -380,16 +748,261 @@ protected:
 
   iterator               m_begin() BOOST_NOEXCEPT;
 
-  branch_value_compare   branch_comp() const {return m_branch_value_compare;}
+  std::size_t    m_lower_bound(branch_node* bp, const key_type& k) const
+    {return m_branch_bound(bp, k, false, search_policy());}
+  std::size_t    m_upper_bound(branch_node* bp, const key_type& k) const
+    {return m_branch_bound(bp, k, true, search_policy());}
+  leaf_value*    m_lower_bound(leaf_node* lp, const key_type& k) const
+    {return m_node_bound(lp->begin(), lp->end(), k, false, value_comp(), leaf_search());}
+  leaf_value*    m_upper_bound(leaf_node* lp, const key_type& k) const
+    {return m_node_bound(lp->begin(), lp->end(), k, true, value_comp(), leaf_search());}
+  // Returns:  std::lower_bound() or std::upper_bound() of k over the node's elements;
+  //           for a branch, as the index of a key, and so of the child to descend to.
+  // Remarks:  The search is chosen by search_policy. For integral keys ordered by
+  //           std::less or std::greater, branchless_search uses the SIMD kernels of
+  //           detail::simd_bound() if the CPU supports them.
+
+  typedef detail::is_simd_searchable<Key, Compare>  simd_searchable;
+  typedef typename std::conditional<eytzinger_branches::value, branchless_search,
+    search_policy>::type                            leaf_search;
+
+  template <class Policy>
+  std::size_t    m_branch_bound(branch_node* bp, const key_type& k, bool upper,
+    Policy) const
+  {
+    return m_node_bound(bp->begin(), bp->end(), k, upper, key_comp(), Policy())
+      - bp->begin();
+  }
+  std::size_t    m_branch_bound(branch_node* bp, const key_type& k, bool upper,
+    eytzinger_search) const
+  {
+    return detail::eytzinger_bound(bp->eytzinger_keys(m_max_branch_size),
+      bp->eytzinger_ranks(m_max_branch_size), bp->size(), k, upper, key_comp());
+  }
+
+  void           m_prefetch(node* np, std::size_t height, std::size_t levels = 1) const
+  {
+    BOOST_BTREE_PREFETCH(np);
+    if (height == 0)
+      m_prefetch_probes(static_cast<leaf_node*>(np)->begin(), m_max_leaf_size, levels);
+    else
+      m_prefetch_probes(static_cast<branch_node*>(np), levels, eytzinger_branches());
+  }
+  // Effects:  Prefetches the cache lines a search of np, of the given height, is likely
+  //           to read first: its header, and the probes of the first levels of a
+  //           binary search of its keys were it full, or with eytzinger_search, the
+  //           root of a branch's Eytzinger tree. Descents call it as soon as the child
+  //           pointer is known, so those misses overlap rather than the first probe
+  //           waiting on the header for the node's size.
+
+  void           m_prefetch_probes(branch_node* bp, std::size_t levels,
+    std::false_type) const
+    {m_prefetch_probes(bp->begin(), m_max_branch_size, levels);}
+  void           m_prefetch_probes(branch_node* bp, std::size_t, std::true_type) const
+    {BOOST_BTREE_PREFETCH(bp->eytzinger_keys(m_max_branch_size) + 1);}
+  template <class T>
+  static void    m_prefetch_probes(T* first, std::size_t max_elements,
+    std::size_t levels)
+  {
+    for (std::size_t parts = 2; levels != 0; --levels, parts *= 2)
+      for (std::size_t i = 1; i < parts; i += 2)
+        BOOST_BTREE_PREFETCH(first + i * max_elements / parts);
+  }
+
+  template <class T, class Comp>
+  static T* m_node_bound(T* first, T* last, const key_type& k, bool upper, Comp comp,
+    standard_search)
+  {
+    return upper ? std::upper_bound(first, last, k, comp)
+      : std::lower_bound(first, last, k, comp);
+  }
+
+  template <class T, class Comp>
+  static T* m_node_bound(T* first, T* last, const key_type& k, bool upper, Comp comp,
+    branchless_search)
+    {return m_node_bound(first, last, k, upper, comp, simd_searchable());}
+
+  template <class T, class Comp>
+  static T* m_node_bound(T* first, T* last, const key_type& k, bool upper, Comp comp,
+    std::false_type)
+    {return detail::branchless_bound(first, last - first, k, upper, comp);}
+
+#ifdef BOOST_BTREE_SIMD_SEARCH
+  template <class T, class Comp>
+  static T* m_node_bound(T* first, T* last, const key_type& k, bool upper, Comp comp,
+    std::true_type)
+  {
+    detail::simd_level level = detail::simd_support();
+    if (level == detail::simd_none || first == last)
+      return m_node_bound(first, last, k, upper, comp, std::false_type());
+    return first + detail::simd_bound<Key, Compare>(m_key_address(first), last - first,
+      sizeof(T), k, upper, level);
+  }
+
+  static const char* m_key_address(const key_type* p)  // a branch's or a set's
+    {return reinterpret_cast<const char*>(p);}
+  template <class T>
+  static const char* m_key_address(const std::pair<key_type, T>* p)  // a map's
+    {return reinterpret_cast<const char*>(&p->first);}
+#endif
 
   void      m_init();
-  void      m_free_all(node* np);
+  void      m_reindex(branch_node* bp)  {m_reindex(bp, eytzinger_branches());}
+  void      m_reindex(branch_node*, std::false_type)  {}
+  void      m_reindex(branch_node* bp, std::true_type)
+  {
+    detail::eytzinger_fill(bp->begin(), bp->size(),
+      bp->eytzinger_keys(m_max_branch_size), bp->eytzinger_ranks(m_max_branch_size));
+  }
+  // Effects:  With eytzinger_search, rebuilds bp's Eytzinger arrays from its sorted
+  //           keys; otherwise does nothing. Every change to a branch's keys is followed
+  //           by a call.
+
+  //  With order_statistics, count(i) of every branch is the number of elements under
+  //  child(i). Moving a child moves its count, so these fix up only the counts whose
+  //  subtrees gained or lost elements; without order_statistics they do nothing. With
+  //  aggregate_statistics, they fix up aggregate(i) alongside count(i).
+  void      m_add_count(leaf_node* lp, difference_type n)
+                                          {m_add_count(lp, n, counted_branches());}
+  void      m_add_count(leaf_node*, difference_type, std::false_type)  {}
+  void      m_add_count(leaf_node* lp, difference_type n, std::true_type);
+  // Requires: lp is the last leaf, or the child->parent list from lp is valid.
+  // Effects:  Adds n to the count leading to lp in each of its ancestors.
+  void      m_count_append(const value_type& x)  {m_count_append(x, counted_branches());}
+  void      m_count_append(const value_type&, std::false_type)  {}
+  void      m_count_append(const value_type& x, std::true_type);
+  // Requires: x was just added after every other element, on the last leaf.
+  // Effects:  As m_add_count(m_last_leaf, 1), but as x follows every other element,
+  //           combines x's summary into those on the right edge rather than
+  //           recomputing them.
+  void      m_recount_child(branch_node* bp, std::size_t i)
+                                          {m_recount_child(bp, i, counted_branches());}
+  void      m_recount_child(branch_node*, std::size_t, std::false_type)  {}
+  void      m_recount_child(branch_node* bp, std::size_t i, std::true_type)
+  {
+    bp->count(i) = m_subtree_size(bp->child(i));
+    m_reaggregate_child(bp, i, aggregated_branches());
+  }
+  // Requires: The counts of child(i), if a branch, are valid.
+  void      m_reaggregate_child(branch_node*, std::size_t, std::false_type)  {}
+  static void m_combine_aggregate(branch_node*, std::size_t, const value_type&,
+    std::false_type)  {}
+  static void m_combine_aggregate(branch_node* bp, std::size_t i, const value_type& x,
+    std::true_type)
+    {monoid_type m; bp->aggregate(i) = m.combine(bp->aggregate(i), m.element(x));}
+  void      m_reaggregate_child(branch_node* bp, std::size_t i, std::true_type)
+                                {bp->aggregate(i) = m_subtree_aggregate(bp->child(i));}
+  void      m_recount_ancestors(node* np, bool siblings = false)
+                               {m_recount_ancestors(np, siblings, counted_branches());}
+  void      m_recount_ancestors(node*, bool, std::false_type)  {}
+  void      m_recount_ancestors(node* np, bool siblings, std::true_type);
+  // Requires: The child->parent list from np is valid.
+  // Effects:  Bottom up, recounts np and each of its ancestors, and if siblings, the
+  //           children either side of each of them.
+  void      m_recount()  {m_recount(counted_branches());}
+  void      m_recount(std::false_type)  {}
+  void      m_recount(std::true_type)  {m_recount_subtree(m_root);}
+  // Effects:  Sets every count, as the bulk builders leave them unset.
+  // Complexity: Linear in the number of nodes.
+  size_type m_recount_subtree(node* np);
+  void      m_recount_right_edge(node* np);
+  // Effects:  Bottom up, recounts each node on the right edge of np's subtree.
+  static size_type m_subtree_size(node* np);
+  // Returns:  The number of elements under np, given np's counts if a branch.
+  static aggregate_type m_subtree_aggregate(node* np);
+  // Returns:  The combined summaries of the elements under np, given np's aggregates
+  //           if a branch.
+  static aggregate_type m_aggregate(node* np, size_type first, size_type last);
+  // Returns:  The combined summaries of the elements under np whose positions in
+  //           np's subtree are in [first, last).
+  size_type m_rank(const key_type& k, bool upper, leaf_node*& lp,
+    leaf_value*& ep) const;
+  // Returns:  rank(k), or the number of elements with keys not greater than k if
+  //           upper. lp and ep are set to lower_bound(k), or upper_bound(k), which may
+  //           be the end of a leaf.
+  size_type m_count(const key_type& k, std::false_type) const;
+  size_type m_count(const key_type& k, std::true_type) const;
+  void      m_free_all(node* np)  {m_free_all(np, m_pool);}
+  void      m_free_all(node* np, node_pool& pool);
+  void      m_release_all();
+  // Effects:  Frees every node, returning all slabs to the allocator, and only visiting
+  //           the nodes if elements have non-trivial destructors. m_root is left
+  //           dangling.
   void      m_new_root();
   iterator  m_special_lower_bound(const key_type& k) const;
+  std::size_t m_lower_bound_child(branch_node* bp, const key_type& k) const;
+  // Returns:  The index of the child of bp that a descent for k's lower bound takes.
+  iterator  m_adjust_lower_bound(iterator low, const key_type& k);
+  // Requires: low is the lower bound of k within the leaf a descent for k reached.
+  // Returns:  lower_bound(k).
   iterator  m_special_upper_bound(const key_type& k) const;
+  // Remarks:  Like all lookups, these do not write to the tree; they neither create
+  //           the child->parent list nor depend on it. Thus concurrent calls of const
+  //           member functions are safe.
   iterator  m_last();
   void      m_erase_from_parent(node* child);
+  void      m_rebalance(leaf_node*& np, leaf_value*& ep);
+  // Requires: np isn't the root, and the child->parent list is valid for np.
+  // Effects:  Borrows elements for np from an adjacent sibling, or merges np with it.
+  //           If np's elements move, np and ep are set to the node and element that
+  //           *ep moved to.
+  void      m_rebalance(branch_node* np);
+  // Requires: np isn't the root, and the child->parent list is valid for np.
+  // Effects:  As for a leaf, rotating keys through the parent.
+  void      m_erase_merged(node* right, branch_node* parent, std::size_t right_index);
+  // Effects:  Erases right, whose elements have been merged into its left sibling, from
+  //           parent, then rebalances parent if it has become underfull.
+  size_type m_erase_children(branch_node* bp, std::size_t first, std::size_t last);
+  // Effects:  Frees the subtrees of bp's children [first, last), and erases them and
+  //           the keys that separated them from bp. Leaves are not unlinked.
+  // Returns:  The number of elements freed.
+  size_type m_free_subtree(node* np);
+  // Effects:  Frees np and all of its descendants. Leaves are not unlinked.
+  // Returns:  The number of elements freed.
+  void      m_rebalance_ancestors(leaf_node* np);
+  // Requires: np isn't empty.
+  // Effects:  Rebalances each ancestor of np, other than the root, that is underfull,
+  //           from the bottom up.
+  void      m_rebalance_edge(leaf_node* np);
+  // Requires: np isn't empty.
+  // Effects:  As m_rebalance_ancestors(np), then rebalances np if it is underfull. A
+  //           cut or graft leaves nodes underfull only along one edge of the tree.
+  void      m_trim_root();
+  // Effects:  While the root is a branch with only one child, makes that child the root.
+  static size_type m_tally(node* np, size_type& nodes, std::false_type);
+  static size_type m_tally(node* np, size_type& nodes, std::true_type);
+  // Effects:  Adds the number of nodes in np's subtree to nodes.
+  // Returns:  The number of elements in np's subtree; with counted branches, the leaves
+  //           need not be visited to find it.
+  void      m_build_parent_list(leaf_node* np);
+  // Effects:  Creates the child->parent list from the root down to np, so that np and
+  //           all of its ancestors have valid parent_node() and parent_index().
+  void      m_link_leaf(leaf_node* np, leaf_node* new_np);
+  // Effects:  Links new_np into the leaf sibling list immediately after np.
+  void      m_unlink_leaf(leaf_node* np);
+  // Effects:  Removes np from the leaf sibling list.
   void      m_dump_node(std::ostream& os, node* np) const;
+  void      m_clone_tree(const mbt_base& x);
+  // Requires: node_size() == x.node_size(). The current tree, if any, has already been
+  //           freed or detached by the caller.
+  // Effects:  Makes the tree a node by node copy of x's tree, with the same shape and
+  //           no key comparisons. If x.size() >= parallel_clone_min_size and the
+  //           allocator is stateless, subtrees of the root are cloned in parallel.
+  static leaf_node* m_leftmost_leaf(node* np);
+  node*     m_clone(node* np, leaf_node*& prior, node_pool& pool);
+  // Effects:  Returns a copy of the subtree rooted at np, with its nodes taken from
+  //           pool and its leaves linked after prior. prior is set to the last leaf
+  //           of the copy.
+  // Remarks:  Writes only to the nodes it creates, so may run concurrently.
+#ifdef BOOST_BTREE_PARALLEL_CLONE
+  node*     m_parallel_clone(branch_node* np, leaf_node*& first, leaf_node*& last);
+#endif
+  void      m_bulk_append(node* np, const key_type& k, node* new_np,
+                          size_type max_elements);
+  // Requires: np is the rightmost node at its height, and has valid parent_node()
+  //           and parent_index().
+  // Effects:  Appends k and new_np to the parent of np, adding a new parent after it
+  //           at its height, or a new root, if the parent already holds max_elements.
 
   std::pair<iterator, bool>
             m_insert_unique(const value_type& x);
@@ -401,28 +1014,106 @@ protected:
   template <class P>
   iterator  m_insert_non_unique(P&& x);
 
+  iterator  m_insert_hint(const_iterator hint, value_type&& x);
+  // Effects:  Inserts x as close as possible to just before hint, or for unique
+  //           containers, unless an element with an equivalent key is present.
+  // Returns:  An iterator to the inserted element, or to the equivalent element.
+  // Remarks:  If x belongs just before hint, and hint and its predecessor are on the
+  //           same leaf, or hint is end() or the first element, no branch is searched.
+  // Complexity: Amortized constant if x belongs just before hint, otherwise as insert.
+
   void      m_leaf_insert(value_type&& v, leaf_node*& np, leaf_value*& ep);
   // Remarks:  np points to the node where insertion is to occur
   //           ep points to the element where insertion is to occur
   // Effects:  Inserts v at *ep. If the insertion causes a node to be split,
   //           and the ep falls on the newly split node, np and ep are set to point to
-  //           the new node and appropriate element
+  //           the new node and appropriate element. The child->parent list is only
+  //           created, via m_build_parent_list(), if a split occurs, or with
+  //           order_statistics, to update the counts.
 
   void      m_branch_insert(key_type&& k, node* old_np, node* new_np);
-  // Effects:  inserts k and new_np at old_np->parent_element()->second and
-  //           (old_np->parent_element()+1)->first, respectively
+  // Effects:  Inserts k as the key following old_np in its parent, and new_np as the
+  //           child following k.
   // Postcondition: For the nodes pointed to by old_np and new_np, parent_node() and
-  //           parent_element() are valid. i.e. updated if needed
+  //           parent_index() are valid. i.e. updated if needed
+
+  template <class Node>
+  Node*     m_new_node(uint16_t height_, size_type max_elements)
+                              {return m_new_node<Node>(height_, max_elements, m_pool);}
+  template <class Node>
+  Node*     m_new_node(uint16_t height_, size_type max_elements, node_pool& pool);
 
   template <class Node>
-  Node*     m_new_node(uint16_t height_, size_type max_elements);
+  void      m_free_node(Node* np)  {m_free_node(np, m_pool);}
+  template <class Node>
+  void      m_free_node(Node* np, node_pool& pool);
+  // Effects:  Destroys np's elements and puts np on pool's free list for its kind.
+
+  void      m_add_slab(node_pool& pool, std::size_t min_units);
+  void      m_release_pool(node_pool& pool);
+  // Effects:  Returns pool's slabs to the allocator, and those of the shared lists it
+  //           is the last to hold, leaving pool empty.
+  void      m_release_slabs(slab* sp);
+  // Effects:  Returns sp and the slabs following it to the allocator.
+  void      m_splice_pool(node_pool& pool);
+  // Effects:  Moves pool's slabs, shared lists and free nodes to m_pool, leaving pool
+  //           empty.
+  void      m_share_pool(node_pool& pool);
+  // Effects:  Shares m_pool's slabs, and the lists m_pool shares, with pool.
+  std::size_t m_trim_pool();
+  // Effects:  Returns slabs that hold only free nodes to the allocator.
+  // Returns:  The number of bytes returned.
+  void      m_pack_leaves(size_type target);
+  // Effects:  Moves elements toward the first leaf so each leaf holds at least
+  //           target elements, then frees the leaves left empty.
+  void      m_move_leaves(node_pool& old_pool);
+  // Effects:  Moves every leaf to a new node from m_pool, freeing the old one to
+  //           old_pool.
+  void      m_rebuild_branches(size_type target, node_pool& old_pool);
+  // Effects:  Frees the branches to old_pool, then builds new ones above the leaves,
+  //           holding target elements each.
+  void      m_free_branches(node* np, node_pool& pool);
 
   template <class Node>
-  void      m_free_node(Node* np);
+  static std::size_t m_node_units(size_type max_elements)
+  {
+    return (sizeof(Node) + Node::extra_space(max_elements)
+      + max_elements * sizeof(typename Node::value_type) + sizeof(pool_unit) - 1)
+      / sizeof(pool_unit);
+  }
+  static node*& m_free_list(node_pool& pool, leaf_node*)    {return pool.free_leaves;}
+  static node*& m_free_list(node_pool& pool, branch_node*)  {return pool.free_branches;}
+
+  void      m_swap_allocator(mbt_base& x, std::true_type)
+                                              {using std::swap; swap(m_alloc, x.m_alloc);}
+  void      m_swap_allocator(mbt_base& x, std::false_type)
+  // Requires: get_allocator() == x.get_allocator(), as for standard containers
+                                              {BOOST_ASSERT(m_alloc == x.m_alloc);}
+  void      m_assign_allocator(const mbt_base& x, std::true_type);
+  void      m_assign_allocator(const mbt_base&, std::false_type) {}
 
   template <class Node>
   static Node* node_cast(node* np) {return reinterpret_cast<Node*>(np);}
 
+  const key_type& m_last_key() const
+                       {return key(*reinterpret_cast<const value_type*>(m_last_leaf->end()-1));}
+  bool      m_at_right_edge(const key_type& k) const
+  {
+    return empty() || (std::is_same<uniqueness, unique>::value
+      ? key_comp()(m_last_key(), k) : !key_comp()(k, m_last_key()));
+  }
+  // Returns: true if an element with key k belongs after every element, so can be
+  //          inserted by m_append() without a search.
+  iterator  m_append(value_type&& x);
+  // Requires: m_at_right_edge(key(x))
+  // Effects:  Inserts x after the last element. If the last leaf is full, x starts a
+  //           new leaf rather than splitting it, so leaves filled by ascending inserts
+  //           stay full.
+
+  iterator  m_insert_hint(value_type&& x, unique)
+                                         { return m_insert_unique(std::move(x)).first; }
+  iterator  m_insert_hint(value_type&& x, non_unique)
+                                         { return m_insert_non_unique(std::move(x)); }
   void      m_insert(const value_type& x, unique)  { m_insert_unique(x); }
   void      m_insert(const value_type& x, non_unique) { m_insert_non_unique(x); }
 
@@ -443,8 +1134,8 @@ protected:
 template <class Key, class Base, class Compare, class Allocator>
 mbt_base<Key,Base,Compare,Allocator>::
 mbt_base(size_type node_sz, const Compare& comp, const Allocator& alloc)
-    : m_node_size(node_sz), m_key_compare(comp), m_value_compare(comp),
-      m_branch_value_compare(comp), m_alloc(alloc)
+    : m_node_size(node_sz), m_min_fill(default_min_fill), m_key_compare(comp),
+      m_value_compare(comp), m_alloc(alloc)
 {
   m_init();
  }
@@ -456,13 +1147,11 @@ template <class InputIterator>
 mbt_base<Key,Base,Compare,Allocator>::
 mbt_base(InputIterator first, InputIterator last,
         size_type node_sz, const Compare& comp, const Allocator& alloc)
-    : m_node_size(node_sz), m_key_compare(comp), m_value_compare(comp),
-      m_branch_value_compare(comp), m_alloc(alloc)
+    : m_node_size(node_sz), m_min_fill(default_min_fill), m_key_compare(comp),
+      m_value_compare(comp), m_alloc(alloc)
 {
   m_init();
-
-  for (; first != last; ++first)
-    m_insert(*first, uniqueness());
+  bulk_load(first, last);
 }
 
 //-------------------------------  copy constructor  -----------------------------------//
@@ -470,14 +1159,16 @@ mbt_base(InputIterator first, InputIterator last,
 template <class Key, class Base, class Compare, class Allocator>
 mbt_base<Key,Base,Compare,Allocator>::
 mbt_base(const mbt_base<Key,Base,Compare,Allocator>& x)
-  : m_node_size(x.node_size()), m_key_compare(x.key_comp()),
-    m_value_compare(x.key_comp()), m_branch_value_compare(x.key_comp()),
-    m_alloc(x.get_allocator())
+  : m_node_size(x.node_size()), m_min_fill(x.m_min_fill), m_key_compare(x.key_comp()),
+    m_value_compare(x.key_comp()),
+    m_alloc(std::allocator_traits<Allocator>::
+      select_on_container_copy_construction(x.get_allocator()))
 {
-  m_init();
-
-  for (const_iterator it = x.begin(); it != x.end(); ++it)
-    m_insert(*it, uniqueness());
+  m_max_leaf_size = x.m_max_leaf_size;
+  m_max_branch_size = x.m_max_branch_size;
+  m_min_leaf_size = x.m_min_leaf_size;
+  m_min_branch_size = x.m_min_branch_size;
+  m_clone_tree(x);
 }
 
 //-------------------------------  copy assignment  ------------------------------------//
@@ -487,14 +1178,257 @@ mbt_base<Key,Base,Compare,Allocator>&
 mbt_base<Key,Base,Compare,Allocator>::
 operator=(const mbt_base<Key,Base,Compare,Allocator>& x)
 {
-  clear();
+  if (this == &x)
+    return *this;
+
+  m_assign_allocator(x, typename std::allocator_traits<Allocator>::
+    propagate_on_container_copy_assignment());
 
-  for (const_iterator it = x.begin(); it != x.end(); ++it)
-    m_insert(*it, uniqueness());
+  if (node_size() != x.node_size())
+  {
+    // the shape of x's tree doesn't fit our nodes, but x is sorted, so building
+    // bottom-up is still linear
+    clear();
+    m_key_compare = x.m_key_compare;
+    m_value_compare = x.m_value_compare;
+    bulk_load(x.begin(), x.end());
+    return *this;
+  }
 
+  node* old_root = m_root;
+  m_clone_tree(x);  // on an exception, nothing has changed
+  m_free_all(old_root);
+  m_key_compare = x.m_key_compare;
+  m_value_compare = x.m_value_compare;
   return *this;
 }
 
+//--------------------------------  m_clone_tree()  ------------------------------------//
+
+template <class Key, class Base, class Compare, class Allocator>
+void
+mbt_base<Key,Base,Compare,Allocator>::
+m_clone_tree(const mbt_base& x)
+{
+  BOOST_ASSERT(node_size() == x.node_size());
+
+  leaf_node* first = 0;
+  leaf_node* last = 0;
+  node* root;
+
+#ifdef BOOST_BTREE_PARALLEL_CLONE
+  // a stateful allocator, such as a std::pmr memory resource, may not be thread safe
+  if (x.size() >= parallel_clone_min_size && x.m_root->is_branch()
+      && std::is_empty<Allocator>::value)
+    root = m_parallel_clone(node_cast<branch_node>(x.m_root), first, last);
+  else
+#endif
+  {
+    root = m_clone(x.m_root, last, m_pool);
+    first = m_leftmost_leaf(root);
+  }
+
+  root->parent_node(0);
+  root->parent_index(0);
+  m_root = root;
+  m_first_leaf = first;
+  m_last_leaf = last;
+  m_last_leaf->owner(this);
+  m_size = x.m_size;
+}
+
+//-------------------------------  m_leftmost_leaf()  ----------------------------------//
+
+template <class Key, class Base, class Compare, class Allocator>
+typename mbt_base<Key,Base,Compare,Allocator>::leaf_node*
+mbt_base<Key,Base,Compare,Allocator>::
+m_leftmost_leaf(node* np)
+{
+  while (np->is_branch())
+    np = node_cast<branch_node>(np)->child(0);
+  return node_cast<leaf_node>(np);
+}
+
+//-----------------------------------  m_clone()  --------------------------------------//
+
+template <class Key, class Base, class Compare, class Allocator>
+typename mbt_base<Key,Base,Compare,Allocator>::node*
+mbt_base<Key,Base,Compare,Allocator>::
+m_clone(node* np, leaf_node*& prior, node_pool& pool)
+{
+  if (np->is_leaf())
+  {
+    leaf_node* src = node_cast<leaf_node>(np);
+    leaf_node* lp = m_new_node<leaf_node>(0U, m_max_leaf_size, pool);
+    try
+    {
+      std::uninitialized_copy(src->begin(), src->end(), lp->begin());
+    }
+    catch (...)
+    {
+      m_free_node(lp, pool);  // size() is still 0
+      throw;
+    }
+    lp->size(src->size());
+    lp->_prior_leaf = prior;
+    lp->_next_leaf = 0;
+    if (prior)
+      prior->_next_leaf = lp;
+    prior = lp;
+    return lp;
+  }
+
+  branch_node* src = node_cast<branch_node>(np);
+  branch_node* bp = m_new_node<branch_node>(src->height(), m_max_branch_size, pool);
+  node* child = 0;  // a child not yet owned by bp
+  try
+  {
+    for (std::size_t i = 0; i != src->size(); ++i)
+    {
+      child = m_clone(src->child(i), prior, pool);
+      ::new (bp->end()) key_type(src->key(i));
+      bp->children()[i] = src->children()[i];  // copies any count
+      bp->child(i) = child;
+      child->parent_node(bp);
+      child->parent_index(i);
+      child = 0;
+      ++bp->_size;
+    }
+    child = m_clone(src->child(src->size()), prior, pool);  // last child
+  }
+  catch (...)
+  {
+    if (child)
+      m_free_all(child, pool);
+    for (std::size_t i = 0; i != bp->size(); ++i)
+      m_free_all(bp->child(i), pool);
+    m_free_node(bp, pool);
+    throw;
+  }
+  bp->children()[bp->size()] = src->children()[bp->size()];
+  bp->child(bp->size()) = child;
+  child->parent_node(bp);
+  child->parent_index(bp->size());
+  m_reindex(bp);
+  return bp;
+}
+
+#ifdef BOOST_BTREE_PARALLEL_CLONE
+
+//------------------------------  m_parallel_clone()  ----------------------------------//
+
+template <class Key, class Base, class Compare, class Allocator>
+typename mbt_base<Key,Base,Compare,Allocator>::node*
+mbt_base<Key,Base,Compare,Allocator>::
+m_parallel_clone(branch_node* np, leaf_node*& first, leaf_node*& last)
+{
+  // Copy np's keys, then divide its children into contiguous ranges, one per task.
+  // Each task takes nodes from its own pool, and links the leaves of its range into
+  // a separate list. The pools and lists are joined once all tasks are done.
+
+  branch_node* bp = m_new_node<branch_node>(np->height(), m_max_branch_size);
+  try
+  {
+    for (key_type* it = np->begin(); it != np->end(); ++it)
+    {
+      ::new (bp->end()) key_type(*it);
+      ++bp->_size;
+    }
+  }
+  catch (...)
+  {
+    m_free_node(bp);
+    throw;
+  }
+  m_reindex(bp);
+
+  typedef std::pair<leaf_node*, leaf_node*> leaf_list;  // first, last
+  const std::size_t children = np->size() + 1;
+  const std::size_t tasks = std::min<std::size_t>(children,
+    std::max(1U, std::thread::hardware_concurrency()));
+
+  std::vector<node_pool> pools(tasks);
+  std::vector<std::future<leaf_list> > futures;
+  for (std::size_t t = 0; t < tasks; ++t)
+  {
+    std::size_t lo = children * t / tasks;
+    std::size_t hi = children * (t+1) / tasks;
+    node_pool* pool = &pools[t];
+    futures.push_back(std::async(std::launch::async,
+      [this, np, bp, lo, hi, pool]() -> leaf_list
+      {
+        leaf_list list(0, 0);
+        std::size_t i = lo;
+        try
+        {
+          for (; i != hi; ++i)
+          {
+            node* child = m_clone(np->child(i), list.second, *pool);
+            bp->children()[i] = np->children()[i];  // copies any count
+            bp->child(i) = child;
+            child->parent_node(bp);
+            child->parent_index(i);
+            if (!list.first)
+              list.first = m_leftmost_leaf(child);
+          }
+        }
+        catch (...)
+        {
+          for (std::size_t j = lo; j != i; ++j)
+            m_free_all(bp->child(j), *pool);
+          throw;
+        }
+        return list;
+      }));
+  }
+
+  std::vector<leaf_list> lists;
+  std::exception_ptr ex;
+  std::vector<bool> ok;
+  for (std::size_t t = 0; t < tasks; ++t)
+  {
+    try
+    {
+      lists.push_back(futures[t].get());
+      ok.push_back(true);
+    }
+    catch (...)
+    {
+      if (!ex)
+        ex = std::current_exception();
+      lists.push_back(leaf_list(0, 0));
+      ok.push_back(false);
+    }
+  }
+
+  if (ex)
+  {
+    for (std::size_t t = 0; t < tasks; ++t)
+    {
+      if (ok[t])
+        for (std::size_t j = children * t / tasks; j != children * (t+1) / tasks; ++j)
+          m_free_all(bp->child(j), pools[t]);
+      m_release_pool(pools[t]);
+    }
+    m_free_node(bp);
+    std::rethrow_exception(ex);
+  }
+
+  for (std::size_t t = 0; t < tasks; ++t)
+    m_splice_pool(pools[t]);
+
+  for (std::size_t t = 1; t < tasks; ++t)
+  {
+    lists[t-1].second->_next_leaf = lists[t].first;
+    lists[t].first->_prior_leaf = lists[t-1].second;
+  }
+  first = lists.front().first;
+  last = lists.back().second;
+  return bp;
+}
+
+#endif  // BOOST_BTREE_PARALLEL_CLONE
+
 //-----------------------------------  m_init()  ---------------------------------------//
 
 template <class Key, class Base, class Compare, class Allocator>
@@ -504,9 +1438,14 @@ m_init()
 {
   m_size = 0;
   m_max_leaf_size = node_size() / sizeof(leaf_value);
-  m_max_branch_size = node_size() / sizeof(branch_value);
-  m_root = m_new_node<leaf_node>(0U, m_max_leaf_size);
-  m_root->owner(this);
+  m_max_branch_size = node_size() / (sizeof(key_type) + sizeof(child_slot)
+    + (eytzinger_branches::value ? sizeof(key_type) + sizeof(uint16_t) : 0));
+  min_fill(m_min_fill);
+  leaf_node* lp = m_new_node<leaf_node>(0U, m_max_leaf_size);
+  lp->_prior_leaf = 0;
+  lp->_next_leaf = 0;
+  lp->owner(this);
+  m_root = m_first_leaf = m_last_leaf = lp;
 }
 
 //------------------------------------  swap()  ----------------------------------------//
@@ -518,139 +1457,689 @@ swap(mbt_base<Key,Base,Compare,Allocator>&x)
 {
   std::swap(m_key_compare, x.m_key_compare);
   std::swap(m_value_compare, x.m_value_compare);
-  std::swap(m_branch_value_compare, x.m_branch_value_compare);
-  std::swap(m_alloc, x.m_alloc);
+  m_swap_allocator(x,
+    typename std::allocator_traits<Allocator>::propagate_on_container_swap());
   std::swap(m_node_size, x.m_node_size);
+  std::swap(m_min_fill, x.m_min_fill);
   std::swap(m_size, x.m_size);
   std::swap(m_max_leaf_size, x.m_max_leaf_size);
   std::swap(m_max_branch_size, x.m_max_branch_size);
+  std::swap(m_min_leaf_size, x.m_min_leaf_size);
+  std::swap(m_min_branch_size, x.m_min_branch_size);
   std::swap(m_root, x.m_root);
-  std::swap(m_root->_owner, x.m_root->_owner);
+  std::swap(m_first_leaf, x.m_first_leaf);
+  std::swap(m_last_leaf, x.m_last_leaf);
+  std::swap(m_pool, x.m_pool);
+  m_last_leaf->owner(this);
+  x.m_last_leaf->owner(&x);
 }
 
-//---------------------------------  m_free_all()  -------------------------------------//
+//----------------------------------  compact()  ---------------------------------------//
 
 template <class Key, class Base, class Compare, class Allocator>
-void
+typename mbt_base<Key,Base,Compare,Allocator>::size_type
 mbt_base<Key,Base,Compare,Allocator>::
-m_free_all(node* np)
+compact(double fill_factor)
 {
-  if (np->is_leaf())
-    m_free_node<leaf_node>(node_cast<leaf_node>(np));
-  else
-  {
-    branch_node* bp = node_cast<branch_node>(np);
-    branch_value* it;
-    for (it = bp->begin(); it <= bp->end(); ++it)
-    {
-      m_free_all(it->first);
-    }
-    m_free_node<branch_node>(bp);
-  }
+  BOOST_ASSERT_MSG(fill_factor > 0.0 && fill_factor <= 1.0,
+    "compact() fill_factor must be greater than 0.0 and not greater than 1.0");
+
+  m_pack_leaves(std::max<size_type>(1U,
+    static_cast<size_type>(m_max_leaf_size * fill_factor)));
+  m_rebuild_branches(std::max<size_type>(1U,
+    static_cast<size_type>(m_max_branch_size * fill_factor)), m_pool);
+  return m_trim_pool();
 }
 
-//-----------------------------------  clear()  ----------------------------------------//
+//-------------------------------  shrink_to_fit()  ------------------------------------//
 
 template <class Key, class Base, class Compare, class Allocator>
-void
+typename mbt_base<Key,Base,Compare,Allocator>::size_type
 mbt_base<Key,Base,Compare,Allocator>::
-clear() BOOST_NOEXCEPT
+shrink_to_fit()
 {
-  m_free_all(m_root);
-  m_size = 0;
-  m_root = m_new_node<leaf_node>(0U, m_max_leaf_size);
-  m_root->owner(this);
+  m_pack_leaves(m_max_leaf_size);
+
+  // the branches are rebuilt full too, so their number is known up front
+  size_type leaves = 0;
+  for (leaf_node* lp = m_first_leaf; lp; lp = lp->next_leaf())
+    ++leaves;
+  size_type branches = 0;
+  for (size_type n = leaves; n > 1; n = (n + m_max_branch_size) / (m_max_branch_size + 1))
+    branches += (n + m_max_branch_size) / (m_max_branch_size + 1);
+
+  node_pool old_pool;
+  m_add_slab(old_pool, leaves * m_node_units<leaf_node>(m_max_leaf_size)
+    + branches * m_node_units<branch_node>(m_max_branch_size));
+  std::swap(old_pool, m_pool);  // nodes now come from the new slab
+  std::size_t before = old_pool.bytes;
+  m_move_leaves(old_pool);
+  m_rebuild_branches(m_max_branch_size, old_pool);
+  BOOST_ASSERT(old_pool.nodes == 0);
+  m_release_pool(old_pool);
+  return before - m_pool.bytes;
 }
 
-//----------------------------------  m_new_node  --------------------------------------//
+//-------------------------------  m_pack_leaves()  ------------------------------------//
 
 template <class Key, class Base, class Compare, class Allocator>
-template <class Node>
-Node*
+void
 mbt_base<Key,Base,Compare,Allocator>::
-m_new_node(uint16_t height_, size_type max_elements)
+m_pack_leaves(size_type target)
 {
-  std::size_t node_size = sizeof(Node) + Node::extra_space()
-    + max_elements * sizeof(typename Node::value_type);
+  // dst trails src; the leaves in between have been emptied, and each in turn becomes
+  // dst, so elements only move toward the first leaf
+  leaf_node* dst = m_first_leaf;
+  for (leaf_node* src = dst->next_leaf(); src; src = src->next_leaf())
+  {
+    leaf_value* it = src->begin();
+    while (it != src->end())
+    {
+      if (dst->size() >= target)
+      {
+        dst = dst->next_leaf();
+        if (dst == src)  // src's remaining elements stay on it
+        {
+          size_type n = src->end() - it;
+          if (it != src->begin())
+            detail::placement_move(it, src->end(), src->begin());
+          src->size(n);
+          break;
+        }
+      }
+      size_type n = std::min<size_type>(target - dst->size(), src->end() - it);
+      detail::placement_move(it, it + n, dst->end());
+      dst->size(dst->size() + n);
+      it += n;
+    }
+    if (src != dst)
+      src->size(0);  // all its elements have moved
+  }
 
-  Node* np = reinterpret_cast<Node*>(new char[node_size]);
-#ifndef NDEBUG
-  std::memset(np, 0, node_size);
-#endif
-  np->height(height_);
-  np->size(0);
-  np->parent_node(0);
-  np->parent_element(0);
-  return np;
+  for (leaf_node* lp = dst->next_leaf(); lp;)
+  {
+    leaf_node* nxt = lp->next_leaf();
+    m_free_node(lp);
+    lp = nxt;
+  }
+  dst->_next_leaf = 0;
+  dst->owner(this);
+  m_last_leaf = dst;
 }
 
-//---------------------------------  m_free_node  --------------------------------------//
+//-------------------------------  m_move_leaves()  ------------------------------------//
 
 template <class Key, class Base, class Compare, class Allocator>
-template <class Node>
 void
 mbt_base<Key,Base,Compare,Allocator>::
-m_free_node(Node* np)
+m_move_leaves(node_pool& old_pool)
 {
-  typedef typename Node::value_type value_type;
-  for (value_type* it = np->begin(); it != np->end(); ++it)
+  leaf_node* prior = 0;
+  for (leaf_node* lp = m_first_leaf; lp;)
   {
-    it->~value_type();
+    leaf_node* new_lp = m_new_node<leaf_node>(0U, m_max_leaf_size);
+    detail::placement_move(lp->begin(), lp->end(), new_lp->begin());
+    new_lp->size(lp->size());
+    lp->size(0);
+    new_lp->_prior_leaf = prior;
+    if (prior)
+      prior->_next_leaf = new_lp;
+    else
+      m_first_leaf = new_lp;
+    if (m_root == lp)
+      m_root = new_lp;
+    prior = new_lp;
+
+    leaf_node* nxt = lp->next_leaf();
+    m_free_node(lp, old_pool);
+    lp = nxt;
   }
-  delete [] reinterpret_cast<char*>(np);
+  prior->_next_leaf = 0;
+  prior->owner(this);
+  m_last_leaf = prior;
 }
 
-//----------------------------------  m_begin()  ---------------------------------------//
+//----------------------------  m_rebuild_branches()  ----------------------------------//
 
 template <class Key, class Base, class Compare, class Allocator>
-typename mbt_base<Key,Base,Compare,Allocator>::iterator
+void
 mbt_base<Key,Base,Compare,Allocator>::
-m_begin() BOOST_NOEXCEPT
+m_rebuild_branches(size_type target, node_pool& old_pool)
 {
-  if (empty())
-    return end();
-
-  branch_node* bp = node_cast<branch_node>(m_root);
+  if (m_root->is_branch())
+    m_free_branches(m_root, old_pool);
+
+  m_root = m_first_leaf;
+  m_root->parent_node(0);
+  m_root->parent_index(0);
+  for (leaf_node* lp = m_first_leaf; lp->next_leaf(); lp = lp->next_leaf())
+    m_bulk_append(lp,
+      key(*reinterpret_cast<const value_type*>(lp->next_leaf()->begin())),
+      lp->next_leaf(), target);
+  m_recount();
+}
 
-  // work down the tree until a leaf is reached
-  while (bp->is_branch())
-  {
-    // create the child->parent list
-    node* child = bp->begin()->first;
-    child->parent_node(bp);
-    child->parent_element(bp->begin());
-    bp = node_cast<branch_node>(child);
-  }
+//------------------------------  m_free_branches()  -----------------------------------//
 
-  leaf_node* lp = node_cast<leaf_node>(bp);
-  return iterator(lp, lp->begin());
+template <class Key, class Base, class Compare, class Allocator>
+void
+mbt_base<Key,Base,Compare,Allocator>::
+m_free_branches(node* np, node_pool& pool)
+{
+  branch_node* bp = node_cast<branch_node>(np);
+  if (bp->height() > 1)
+    for (std::size_t i = 0; i <= bp->size(); ++i)
+      m_free_branches(bp->child(i), pool);
+  m_free_node(bp, pool);
 }
 
-//------------------------------------ m_last() ----------------------------------------//
+//---------------------------------  min_fill()  ---------------------------------------//
 
 template <class Key, class Base, class Compare, class Allocator>
-typename mbt_base<Key,Base,Compare,Allocator>::iterator
+void
 mbt_base<Key,Base,Compare,Allocator>::
-m_last()
+min_fill(double f)
+{
+  BOOST_ASSERT_MSG(f >= 0.0 && f <= 0.5,
+    "min_fill() must not be less than 0.0 or greater than 0.5");
+  m_min_fill = f;
+  m_min_leaf_size = static_cast<size_type>(m_max_leaf_size * f);
+  m_min_branch_size = static_cast<size_type>(m_max_branch_size * f);
+}
+
+//---------------------------------  bulk_load()  --------------------------------------//
+
+template <class Key, class Base, class Compare, class Allocator>
+template <class InputIterator>
+void
+mbt_base<Key,Base,Compare,Allocator>::
+bulk_load(InputIterator first, InputIterator last, double fill_factor)
 {
+  BOOST_ASSERT_MSG(fill_factor > 0.0 && fill_factor <= 1.0,
+    "bulk_load() fill_factor must be greater than 0.0 and not greater than 1.0");
+
   if (empty())
-    return end();
+  {
+    const size_type leaf_max = std::max<size_type>(1U,
+      static_cast<size_type>(m_max_leaf_size * fill_factor));
+    const size_type branch_max = std::max<size_type>(1U,
+      static_cast<size_type>(m_max_branch_size * fill_factor));
+    leaf_node* lp = m_last_leaf;
+
+    // append to the last leaf while the elements remain in order; when it is full,
+    // start a new leaf and append its first key to the branch above
+    for (; first != last; ++first)
+    {
+      if (lp->size())
+      {
+        const key_type& last_key
+          = key(*reinterpret_cast<const value_type*>(lp->end()-1));
+        if (key_comp()(key(*first), last_key))
+          break;  // out of order, so insert the rest normally
+        if (std::is_same<uniqueness, unique>::value
+            && !key_comp()(last_key, key(*first)))
+          continue;  // duplicate; like insert(), keep the first
+      }
+
+      if (lp->size() == leaf_max)
+      {
+        leaf_node* new_lp = m_new_node<leaf_node>(0U, m_max_leaf_size);
+        m_link_leaf(lp, new_lp);
+
+        // searches look for keys equal to a branch key only to its right, so a run
+        // of equal keys moves to the new leaf (unless the run fills the whole leaf)
+        leaf_value* run = lp->end();
+        while (run - lp->begin() > 1
+          && !key_comp()(key(*reinterpret_cast<const value_type*>(run-1)), key(*first)))
+          --run;
+        detail::placement_move(run, lp->end(), new_lp->begin());
+        new_lp->size(lp->end() - run);
+        lp->size(run - lp->begin());
+
+        ::new (new_lp->end()) leaf_value(*first);
+        ++new_lp->_size;
+        ++m_size;
+        m_bulk_append(lp, key(*reinterpret_cast<const value_type*>(new_lp->begin())),
+          new_lp, branch_max);
+        lp = new_lp;
+      }
+      else
+      {
+        ::new (lp->end()) leaf_value(*first);
+        ++lp->_size;
+        ++m_size;
+      }
+    }
+    m_recount();
+  }
 
-  branch_node* bp = node_cast<branch_node>(m_root);
+  for (; first != last; ++first)
+    m_insert(*first, uniqueness());
+}
 
-  // work down the tree until a leaf is reached
-  while (bp->is_branch())
+//--------------------------------  m_bulk_append()  -----------------------------------//
+
+template <class Key, class Base, class Compare, class Allocator>
+void
+mbt_base<Key,Base,Compare,Allocator>::
+m_bulk_append(node* np, const key_type& k, node* new_np, size_type max_elements)
+{
+  if (np->is_root())
+    m_new_root();
+
+  branch_node* bp = np->parent_node();
+  BOOST_ASSERT(bp->size() == np->parent_index());  // np is rightmost
+
+  if (bp->size() < max_elements)
   {
-    // create the child->parent list
-    node* child = bp->end()->first;
-    child->parent_node(bp);
-    child->parent_element(bp->end());
-    bp = node_cast<branch_node>(child);
+    ::new (bp->end()) key_type(k);
+    bp->child(bp->size()+1) = new_np;
+    ++bp->_size;
+    new_np->parent_node(bp);
+    new_np->parent_index(bp->size());
+    m_reindex(bp);
+  }
+  else
+  {
+    // bp is full, so new_np becomes the only child of a new branch that follows it
+    branch_node* new_bp = m_new_node<branch_node>(bp->height(), m_max_branch_size);
+    new_bp->child(0) = new_np;
+    new_np->parent_node(new_bp);
+    new_np->parent_index(0);
+    m_bulk_append(bp, k, new_bp, max_elements);
   }
+}
 
-  leaf_node* lp = node_cast<leaf_node>(bp);
-  BOOST_ASSERT(lp->size());
-  return iterator(lp, lp->begin()+(lp->size()-1));
+//---------------------------------  m_free_all()  -------------------------------------//
+
+template <class Key, class Base, class Compare, class Allocator>
+void
+mbt_base<Key,Base,Compare,Allocator>::
+m_free_all(node* np, node_pool& pool)
+{
+  if (np->is_leaf())
+    m_free_node<leaf_node>(node_cast<leaf_node>(np), pool);
+  else
+  {
+    branch_node* bp = node_cast<branch_node>(np);
+    for (std::size_t i = 0; i <= bp->size(); ++i)
+    {
+      m_free_all(bp->child(i), pool);
+    }
+    m_free_node<branch_node>(bp, pool);
+  }
+}
+
+//-----------------------------------  clear()  ----------------------------------------//
+
+template <class Key, class Base, class Compare, class Allocator>
+void
+mbt_base<Key,Base,Compare,Allocator>::
+clear() BOOST_NOEXCEPT
+{
+  m_release_all();
+  m_size = 0;
+  leaf_node* lp = m_new_node<leaf_node>(0U, m_max_leaf_size);
+  lp->_prior_leaf = 0;
+  lp->_next_leaf = 0;
+  lp->owner(this);
+  m_root = m_first_leaf = m_last_leaf = lp;
+}
+
+//----------------------------------  m_new_node  --------------------------------------//
+
+template <class Key, class Base, class Compare, class Allocator>
+template <class Node>
+Node*
+mbt_base<Key,Base,Compare,Allocator>::
+m_new_node(uint16_t height_, size_type max_elements, node_pool& pool)
+{
+  std::size_t units = m_node_units<Node>(max_elements);
+  node*& free_list = m_free_list(pool, static_cast<Node*>(0));
+  Node* np;
+
+  if (free_list)
+  {
+    np = node_cast<Node>(free_list);
+    free_list = *reinterpret_cast<node**>(free_list);
+  }
+  else
+  {
+    if (static_cast<std::size_t>(pool.end - pool.next) < units * sizeof(pool_unit))
+      m_add_slab(pool, units);
+    np = reinterpret_cast<Node*>(pool.next);
+    pool.next += units * sizeof(pool_unit);
+  }
+  ++pool.nodes;
+
+#ifndef NDEBUG
+  std::memset(np, 0, units * sizeof(pool_unit));
+#endif
+  np->height(height_);
+  np->size(0);
+  np->parent_node(0);
+  np->parent_index(0);
+  np->init(max_elements);
+  return np;
+}
+
+//---------------------------------  m_free_node  --------------------------------------//
+
+template <class Key, class Base, class Compare, class Allocator>
+template <class Node>
+void
+mbt_base<Key,Base,Compare,Allocator>::
+m_free_node(Node* np, node_pool& pool)
+{
+  typedef typename Node::value_type value_type;
+  if (!std::is_trivially_destructible<value_type>::value)
+  {
+    for (value_type* it = np->begin(); it != np->end(); ++it)
+    {
+      it->~value_type();
+    }
+  }
+
+  node*& free_list = m_free_list(pool, np);
+  *reinterpret_cast<node**>(np) = free_list;
+  free_list = np;
+  --pool.nodes;
+}
+
+//---------------------------------  m_add_slab()  -------------------------------------//
+
+template <class Key, class Base, class Compare, class Allocator>
+void
+mbt_base<Key,Base,Compare,Allocator>::
+m_add_slab(node_pool& pool, std::size_t min_units)
+{
+  // each slab is as large as all prior slabs together, so the number of slabs grows
+  // logarithmically; slabs hold from 4 to 256 of the larger kind of node
+  const std::size_t header = (sizeof(slab) + sizeof(pool_unit) - 1) / sizeof(pool_unit);
+  const std::size_t largest = std::max(m_node_units<leaf_node>(m_max_leaf_size),
+    m_node_units<branch_node>(m_max_branch_size));
+  const std::size_t units = header + std::max(min_units,
+    std::min(std::max(pool.bytes / sizeof(pool_unit), 4 * largest), 256 * largest));
+
+  pool_allocator alloc(m_alloc);
+  slab* sp = reinterpret_cast<slab*>(std::addressof(*pool_traits::allocate(alloc, units)));
+  pool.deactivate();
+  sp->next = pool.slabs;
+  sp->units = units;
+  sp->carved = header;
+  pool.slabs = sp;
+  pool.active = sp;
+  pool.next = reinterpret_cast<char*>(sp) + header * sizeof(pool_unit);
+  pool.end = reinterpret_cast<char*>(sp) + units * sizeof(pool_unit);
+  pool.bytes += units * sizeof(pool_unit);
+}
+
+//-------------------------------  m_release_pool()  -----------------------------------//
+
+template <class Key, class Base, class Compare, class Allocator>
+void
+mbt_base<Key,Base,Compare,Allocator>::
+m_release_pool(node_pool& pool)
+{
+  m_release_slabs(pool.slabs);
+  for (std::size_t i = 0; i != pool.shared.size(); ++i)
+  {
+    if (--pool.shared[i]->owners == 0)
+      m_release_slabs(pool.shared[i]);
+  }
+  pool = node_pool();
+}
+
+template <class Key, class Base, class Compare, class Allocator>
+void
+mbt_base<Key,Base,Compare,Allocator>::
+m_release_slabs(slab* sp)
+{
+  pool_allocator alloc(m_alloc);
+  while (sp)
+  {
+    slab* nxt = sp->next;
+    pool_traits::deallocate(alloc,
+      std::pointer_traits<typename pool_traits::pointer>::pointer_to(
+        *reinterpret_cast<pool_unit*>(sp)), sp->units);
+    sp = nxt;
+  }
+}
+
+//--------------------------------  m_splice_pool()  -----------------------------------//
+
+template <class Key, class Base, class Compare, class Allocator>
+void
+mbt_base<Key,Base,Compare,Allocator>::
+m_splice_pool(node_pool& pool)
+{
+  if (pool.slabs)
+  {
+    slab* tail = pool.slabs;
+    while (tail->next)
+      tail = tail->next;
+    tail->next = m_pool.slabs;
+    m_pool.slabs = pool.slabs;
+    if (pool.end - pool.next > m_pool.end - m_pool.next)  // keep the larger space
+    {
+      m_pool.deactivate();
+      m_pool.active = pool.active;
+      m_pool.next = pool.next;
+      m_pool.end = pool.end;
+    }
+    else
+      pool.deactivate();
+  }
+
+  node** tail = &pool.free_leaves;
+  while (*tail)
+    tail = reinterpret_cast<node**>(*tail);
+  *tail = m_pool.free_leaves;
+  m_pool.free_leaves = pool.free_leaves;
+
+  tail = &pool.free_branches;
+  while (*tail)
+    tail = reinterpret_cast<node**>(*tail);
+  *tail = m_pool.free_branches;
+  m_pool.free_branches = pool.free_branches;
+
+  // a list both pools hold is now held once
+  for (std::size_t i = 0; i != pool.shared.size(); ++i)
+  {
+    slab* head = pool.shared[i];
+    if (std::find(m_pool.shared.begin(), m_pool.shared.end(), head)
+      == m_pool.shared.end())
+      m_pool.shared.push_back(head);
+    else
+    {
+      --head->owners;
+      for (slab* sp = head; sp; sp = sp->next)
+        pool.bytes -= sp->units * sizeof(pool_unit);
+    }
+  }
+
+  m_pool.bytes += pool.bytes;
+  m_pool.nodes += pool.nodes;
+  pool = node_pool();
+}
+
+//--------------------------------  m_share_pool()  ------------------------------------//
+
+template <class Key, class Base, class Compare, class Allocator>
+void
+mbt_base<Key,Base,Compare,Allocator>::
+m_share_pool(node_pool& pool)
+{
+  pool.shared.reserve(pool.shared.size() + m_pool.shared.size() + 1);
+  for (std::size_t i = 0; i != m_pool.shared.size(); ++i)
+  {
+    slab* head = m_pool.shared[i];
+    if (std::find(pool.shared.begin(), pool.shared.end(), head) != pool.shared.end())
+      continue;
+    ++head->owners;
+    pool.shared.push_back(head);
+    for (slab* sp = head; sp; sp = sp->next)
+      pool.bytes += sp->units * sizeof(pool_unit);
+  }
+
+  // m_pool's own slabs become a list both hold; m_pool keeps carving nodes from its
+  // active slab, since pool never does
+  if (m_pool.slabs)
+  {
+    slab* head = m_pool.slabs;
+    ::new (&head->owners) std::atomic<std::size_t>(2);
+    m_pool.slabs = 0;
+    m_pool.shared.push_back(head);
+    pool.shared.push_back(head);
+    for (slab* sp = head; sp; sp = sp->next)
+      pool.bytes += sp->units * sizeof(pool_unit);
+  }
+}
+
+//---------------------------------  m_trim_pool()  ------------------------------------//
+
+template <class Key, class Base, class Compare, class Allocator>
+std::size_t
+mbt_base<Key,Base,Compare,Allocator>::
+m_trim_pool()
+{
+  // tally the free units in each slab, finding slabs by address; free nodes may lie in
+  // shared slabs too, though only m_pool's own slabs can be returned
+  std::vector<std::pair<char*, std::size_t> > slabs;  // start, free units
+  for (slab* sp = m_pool.slabs; sp; sp = sp->next)
+    slabs.push_back(std::make_pair(reinterpret_cast<char*>(sp), std::size_t(0)));
+  for (std::size_t i = 0; i != m_pool.shared.size(); ++i)
+    for (slab* sp = m_pool.shared[i]; sp; sp = sp->next)
+      slabs.push_back(std::make_pair(reinterpret_cast<char*>(sp), std::size_t(0)));
+  std::sort(slabs.begin(), slabs.end());
+
+  auto free_units = [&slabs](void* p) -> std::size_t&
+  {
+    return (std::upper_bound(slabs.begin(), slabs.end(),
+      std::make_pair(static_cast<char*>(p), ~std::size_t(0))) - 1)->second;
+  };
+
+  const std::size_t leaf_units = m_node_units<leaf_node>(m_max_leaf_size);
+  const std::size_t branch_units = m_node_units<branch_node>(m_max_branch_size);
+  for (node* np = m_pool.free_leaves; np; np = *reinterpret_cast<node**>(np))
+    free_units(np) += leaf_units;
+  for (node* np = m_pool.free_branches; np; np = *reinterpret_cast<node**>(np))
+    free_units(np) += branch_units;
+
+  // a slab with as many free units as it has carved out holds no node in use; flag it
+  // by setting its free units to ~0
+  const std::size_t header = (sizeof(slab) + sizeof(pool_unit) - 1) / sizeof(pool_unit);
+  bool any = false;
+  for (slab* sp = m_pool.slabs; sp; sp = sp->next)
+  {
+    std::size_t& free = free_units(sp);
+    std::size_t carved = sp == m_pool.active
+      ? (m_pool.next - reinterpret_cast<char*>(sp)) / sizeof(pool_unit)
+      : sp->carved;
+    if (free == carved - header)
+    {
+      free = ~std::size_t(0);
+      any = true;
+    }
+  }
+  if (!any)
+    return 0;
+
+  // drop the free nodes in flagged slabs, then the slabs themselves
+  node** free_lists[] = {&m_pool.free_leaves, &m_pool.free_branches};
+  for (int i = 0; i < 2; ++i)
+  {
+    node** link = free_lists[i];
+    while (*link)
+    {
+      if (free_units(*link) == ~std::size_t(0))
+        *link = *reinterpret_cast<node**>(*link);
+      else
+        link = reinterpret_cast<node**>(*link);
+    }
+  }
+
+  std::size_t released = 0;
+  pool_allocator alloc(m_alloc);
+  for (slab** link = &m_pool.slabs; *link;)
+  {
+    slab* sp = *link;
+    if (free_units(sp) == ~std::size_t(0))
+    {
+      *link = sp->next;
+      if (sp == m_pool.active)
+      {
+        m_pool.active = 0;
+        m_pool.next = m_pool.end = 0;
+      }
+      released += sp->units * sizeof(pool_unit);
+      pool_traits::deallocate(alloc,
+        std::pointer_traits<typename pool_traits::pointer>::pointer_to(
+          *reinterpret_cast<pool_unit*>(sp)), sp->units);
+    }
+    else
+      link = &sp->next;
+  }
+  m_pool.bytes -= released;
+  return released;
+}
+
+//--------------------------------  m_release_all()  -----------------------------------//
+
+template <class Key, class Base, class Compare, class Allocator>
+void
+mbt_base<Key,Base,Compare,Allocator>::
+m_release_all()
+{
+  if (!std::is_trivially_destructible<leaf_value>::value
+      || !std::is_trivially_destructible<key_type>::value)
+    m_free_all(m_root);  // run the element destructors
+  m_release_pool(m_pool);
+}
+
+//-----------------------------  m_assign_allocator()  ---------------------------------//
+
+template <class Key, class Base, class Compare, class Allocator>
+void
+mbt_base<Key,Base,Compare,Allocator>::
+m_assign_allocator(const mbt_base& x, std::true_type)
+{
+  if (!(m_alloc == x.m_alloc))
+  {
+    // nodes must be freed by the allocator that allocated them
+    m_release_all();
+    m_alloc = x.m_alloc;
+    m_init();
+  }
+  else
+    m_alloc = x.m_alloc;
+}
+
+//----------------------------------  m_begin()  ---------------------------------------//
+
+template <class Key, class Base, class Compare, class Allocator>
+typename mbt_base<Key,Base,Compare,Allocator>::iterator
+mbt_base<Key,Base,Compare,Allocator>::
+m_begin() BOOST_NOEXCEPT
+{
+  if (empty())
+    return end();
+
+  return iterator(m_first_leaf, m_first_leaf->begin());
+}
+
+//------------------------------------ m_last() ----------------------------------------//
+
+template <class Key, class Base, class Compare, class Allocator>
+typename mbt_base<Key,Base,Compare,Allocator>::iterator
+mbt_base<Key,Base,Compare,Allocator>::
+m_last()
+{
+  if (empty())
+    return end();
+
+  BOOST_ASSERT(m_last_leaf->size());
+  return iterator(m_last_leaf, m_last_leaf->end()-1);
 }
 
 //-----------------------------  m_op_square_brackets()  -------------------------------//
@@ -660,6 +2149,9 @@ typename mbt_base<Key,Base,Compare,Allocator>::mapped_type&
 mbt_base<Key,Base,Compare,Allocator>::
 m_op_square_brackets(const key_type& k)
 {
+  if (m_at_right_edge(k))
+    return m_append(make_value(k))->second;
+
   iterator it = m_special_lower_bound(k);
 
   bool not_found = it.m_element == it.m_node->end()
@@ -681,6 +2173,9 @@ typename mbt_base<Key,Base,Compare,Allocator>::mapped_type&
 mbt_base<Key,Base,Compare,Allocator>::
 m_op_square_brackets(key_type&& k)
 {
+  if (m_at_right_edge(k))
+    return m_append(make_value(k))->second;
+
   iterator it = m_special_lower_bound(k);
 
   bool not_found = it.m_element == it.m_node->end()
@@ -703,14 +2198,14 @@ mbt_base<Key,Base,Compare,Allocator>::
 m_new_root()
 {
   //std::cout << "***adding new root\n";
-  // create a new root containing only the end pseudo-element
+  // create a new root containing only a child, the old root
   node* old_root = m_root;
   branch_node* new_root
     = m_new_node<branch_node>(old_root->height()+1, m_max_branch_size);
-  new_root->begin()->first = old_root;
-  new_root->owner(this);
+  new_root->child(0) = old_root;
+  m_recount_child(new_root, 0);
   old_root->parent_node(new_root);
-  old_root->parent_element(new_root->begin());
+  old_root->parent_index(0);
   m_root = new_root;
 }
 
@@ -721,6 +2216,9 @@ std::pair<typename mbt_base<Key,Base,Compare,Allocator>::iterator, bool>
 mbt_base<Key,Base,Compare,Allocator>::
 m_insert_unique(const value_type& x)
 {
+  if (m_at_right_edge(key(x)))
+    return std::pair<iterator, bool>(m_append(value_type(x)), true);
+
   iterator insert_point = m_special_lower_bound(key(x));
 
   bool unique = insert_point.m_element == insert_point.m_node->end()
@@ -742,6 +2240,9 @@ std::pair<typename mbt_base<Key,Base,Compare,Allocator>::iterator, bool>
 mbt_base<Key,Base,Compare,Allocator>::
 m_insert_unique(value_type&& x)
 {
+  if (m_at_right_edge(key(x)))
+    return std::pair<iterator, bool>(m_append(std::move(x)), true);
+
   iterator insert_point = m_special_lower_bound(key(x));
 
   bool unique = insert_point.m_element == insert_point.m_node->end()
@@ -762,6 +2263,9 @@ typename mbt_base<Key,Base,Compare,Allocator>::iterator
 mbt_base<Key,Base,Compare,Allocator>::
 m_insert_non_unique(const value_type& x)
 {
+  if (m_at_right_edge(key(x)))
+    return m_append(value_type(x));
+
   iterator insert_point = m_special_upper_bound(key(x));
 
   value_type v = x;
@@ -777,108 +2281,184 @@ typename mbt_base<Key,Base,Compare,Allocator>::iterator
 mbt_base<Key,Base,Compare,Allocator>::
 m_insert_non_unique(P&& x)
 {
+  if (m_at_right_edge(key(x)))
+    return m_append(std::forward<value_type>(x));
+
   iterator insert_point = m_special_lower_bound(key(x));
 
   m_leaf_insert(std::forward<value_type>(x), insert_point.m_node, insert_point.m_element);
   return insert_point;
 }
 
-//-------------------------------  m_leaf_insert()  ------------------------------------//
+//-------------------------------  m_insert_hint()  ------------------------------------//
 
 template <class Key, class Base, class Compare, class Allocator>
-void
+typename mbt_base<Key,Base,Compare,Allocator>::iterator
 mbt_base<Key,Base,Compare,Allocator>::
-m_leaf_insert(value_type&& x,
-              leaf_node*& old_node, leaf_value*& ep)
-    // Requires: old_node points to the node where insertion is to occur
-    //           ep points to the element where insertion is to occur
-    // Effects:  Inserts k and mv at *ep. If the insertion causes a node to be split,
-    //           and the ep falls on the newly split node, old_node and ep are set to
-    //           point to the new node and appropriate element
+m_insert_hint(const_iterator hint, value_type&& x)
 {
-  leaf_node*   np = old_node;
-  leaf_value*  insert_begin = ep;
-  leaf_node*   new_node = 0;
+  const bool is_unique = std::is_same<uniqueness, unique>::value;
 
-  BOOST_ASSERT_MSG(np->size() <= m_max_leaf_size, "internal error");
-
-
-  if (np->size() == m_max_leaf_size)  // if no room on node, node must be split
+  if (!hint.m_node)  // end()
   {
-    //std::cout << "***splitting a leaf\n";
-    if (np->is_root()) // splitting the root?
-      m_new_root();  // create a new root
-
-    new_node = m_new_node<leaf_node>(np->height(), m_max_leaf_size);  // create the new node
+    if (m_at_right_edge(key(x)))
+      return m_append(std::move(x));
+  }
+  else if (hint.m_element != hint.m_node->begin() || hint.m_node == m_first_leaf)
+  {
+    // the leaf holding hint and its predecessor, if any, covers every key between them,
+    // so if x belongs there it can go straight in without consulting the branches
+    const key_type& next = key(*reinterpret_cast<const value_type*>(hint.m_element));
+    bool fits = is_unique ? key_comp()(key(x), next) : !key_comp()(next, key(x));
 
-//    // ck pack conditions now, since leaf seq list update may chg header().last_node_id()
-//    if (m_ok_to_pack
-//        && (insert_begin != np->leaf().end() || np->node_id() != header().last_node_id()))
-//      m_ok_to_pack = false;  // conditions for pack optimization not met
-
-//    // apply pack optimization if applicable
-//    if (m_ok_to_pack)  // have all inserts been ordered and no erases occurred?
-//    {
-//      // pack optimization: instead of splitting np, just put value alone on new_node
-//      m_memcpy_value(&*new_node->leaf().begin(), &key_, key_size, &mapped_value_, mapped_size);  // insert value
-//      new_node->size(value_size);
-//      BOOST_ASSERT(np->parent()->node_id() == np->parent_node_id()); // max_cache_size logic OK?
-//      m_branch_insert(np->parent(), np->parent_element(),
-//        key(*new_node->leaf().begin()), new_node->node_id());
-//      ++m_size;
-//      return const_iterator(new_node, new_node->leaf().begin());
-//    }
-
-    // split node np by moving half the elements to node new_node
-    new_node->size(np->size() / 2);  // round down to minimize move size
-    detail::placement_move(np->end() - new_node->size(), np->end(), new_node->begin());
-    np->size(np->size() - new_node->size());
-
-    // TODO: if the insert point will fall on the new node, it would be faster to
-    // copy the portion before the insert point, copy the value being inserted, and
-    // finally copy the portion after the insert point. However, that's a fair amount of
-    // additional code for something that only happens on half of all leaf splits on average.
-
-    // adjust np and insert_begin if they now fall on the new node due to the split
-    if (insert_begin > np->end())
+    if (fits && hint.m_element != hint.m_node->begin())
     {
-      BOOST_ASSERT((insert_begin-np->end()) >= 0);  // ck offset validity
-      BOOST_ASSERT((insert_begin-np->end()) <= static_cast<std::ptrdiff_t>(new_node->size()));
+      const key_type& prior
+        = key(*reinterpret_cast<const value_type*>(hint.m_element - 1));
+      fits = is_unique ? key_comp()(prior, key(x)) : !key_comp()(key(x), prior);
+    }
 
-      insert_begin = new_node->begin() + (insert_begin - np->end());
-      np = new_node;
+    if (fits)
+    {
+      leaf_node*  np = hint.m_node;
+      leaf_value* ep = hint.m_element;
+      m_leaf_insert(std::move(x), np, ep);
+      return iterator(np, ep);
     }
   }
 
-  BOOST_ASSERT(insert_begin >= np->begin());
-  BOOST_ASSERT(insert_begin <= np->end());
+  // a poor hint; search as if there were none
+  return m_insert_hint(std::move(x), uniqueness());
+}
 
-  // prep memory at end() for use
-  ::new (np->end()) leaf_value;
+//----------------------------------  m_append()  -------------------------------------//
 
-  // make room for insert
-  std::move_backward(insert_begin, np->end(), np->end()+1);
+template <class Key, class Base, class Compare, class Allocator>
+typename mbt_base<Key,Base,Compare,Allocator>::iterator
+mbt_base<Key,Base,Compare,Allocator>::
+m_append(value_type&& x)
+{
+  BOOST_ASSERT(m_at_right_edge(key(x)));
+  leaf_node* lp = m_last_leaf;
 
-  //  insert x at insert_begin
-  *insert_begin = x;
-  ++np->_size;
+  if (lp->size() < m_max_leaf_size)
+  {
+    ::new (lp->end()) leaf_value(std::move(x));
+    ++lp->_size;
+    ++m_size;
+    m_count_append(*reinterpret_cast<const value_type*>(lp->end()-1));
+    return iterator(lp, lp->end()-1);
+  }
+
+  leaf_node* new_lp = m_new_node<leaf_node>(0U, m_max_leaf_size);
+  try
+  {
+    ::new (new_lp->end()) leaf_value(std::move(x));
+  }
+  catch (...)
+  {
+    m_free_node(new_lp);
+    throw;
+  }
+  ++new_lp->_size;
   ++m_size;
+  m_build_parent_list(lp);  // lookups leave the child->parent list untouched
+  m_link_leaf(lp, new_lp);
+  m_bulk_append(lp, key(*reinterpret_cast<const value_type*>(new_lp->begin())),
+    new_lp, m_max_branch_size);
+  m_recount_ancestors(new_lp);
+  return iterator(new_lp, new_lp->begin());
+}
 
-  // if there is a new node, its initial key and leaf_node* are inserted into parent
-  if (new_node)
+//-------------------------------  m_leaf_insert()  ------------------------------------//
+
+template <class Key, class Base, class Compare, class Allocator>
+void
+mbt_base<Key,Base,Compare,Allocator>::
+m_leaf_insert(value_type&& x,
+              leaf_node*& old_node, leaf_value*& ep)
+    // Requires: old_node points to the node where insertion is to occur
+    //           ep points to the element where insertion is to occur
+    // Effects:  Inserts k and mv at *ep. If the insertion causes a node to be split,
+    //           and the ep falls on the newly split node, old_node and ep are set to
+    //           point to the new node and appropriate element
+{
+  leaf_node*   np = old_node;
+  leaf_value*  insert_begin = ep;
+  leaf_node*   new_node = 0;
+
+  BOOST_ASSERT_MSG(np->size() <= m_max_leaf_size, "internal error");
+
+
+  if (np->size() == m_max_leaf_size)  // if no room on node, node must be split
   {
-    key_type first_key = key(*new_node->begin());  // avoid unwanted move
-    m_branch_insert(std::move(first_key), old_node, new_node);
+    //std::cout << "***splitting a leaf\n";
+    m_build_parent_list(np);  // lookups leave the child->parent list untouched
 
-    // if the insert point changed, update the caller's pointers
-    if (ep != insert_begin)
+    if (np->is_root()) // splitting the root?
+      m_new_root();  // create a new root
+
+    new_node = m_new_node<leaf_node>(np->height(), m_max_leaf_size);  // create the new node
+    m_link_leaf(np, new_node);
+
+    // an element following every other element never gets here, since m_append()
+    // starts a new leaf for it instead of splitting, keeping ascending leaves full
+
+    // split node np by moving half the elements to node new_node, rounding down to
+    // minimize move size. If the insert point falls on new_node, x is constructed in
+    // place as the elements are distributed, so no element is moved twice.
+    std::size_t new_size = np->size() / 2;
+    leaf_value* split_point = np->end() - new_size;
+
+    if (insert_begin > split_point)
     {
-      old_node = np;
-      ep = insert_begin;
+      leaf_value* p = detail::placement_move(split_point, insert_begin, new_node->begin());
+      ::new (p) leaf_value(std::move(x));
+      detail::placement_move(insert_begin, np->end(), p+1);
+      np->size(np->size() - new_size);
+      new_node->size(new_size + 1);
+      ++m_size;
+      old_node = new_node;
+      ep = p;
+      key_type first_key = key(*new_node->begin());  // avoid unwanted move
+      m_branch_insert(std::move(first_key), np, new_node);
+      m_recount_ancestors(np, true);  // the other half of each split is adjacent
+      return;
     }
+
+    detail::placement_move(split_point, np->end(), new_node->begin());
+    np->size(np->size() - new_size);
+    new_node->size(new_size);
+  }
+
+  BOOST_ASSERT(insert_begin >= np->begin());
+  BOOST_ASSERT(insert_begin <= np->end());
+
+  // make room for insert, moving each element after the insert point once
+  if (insert_begin == np->end())
+    ::new (np->end()) leaf_value(std::move(x));
+  else
+  {
+    ::new (np->end()) leaf_value(std::move(*(np->end()-1)));
+    detail::move_range_backward(insert_begin, np->end()-1, np->end());
+    *insert_begin = std::move(x);
   }
+  ++np->_size;
+  ++m_size;
 
-//std::cout << "***insert done" << std::endl;
+  // if there is a new node, its initial key and leaf_node* are inserted into parent
+  if (new_node)
+  {
+    key_type first_key = key(*new_node->begin());  // avoid unwanted move
+    m_branch_insert(std::move(first_key), np, new_node);
+    m_recount_ancestors(np, true);  // the other half of each split is adjacent
+  }
+  else if (counted_branches::value)
+  {
+    if (np != m_last_leaf)
+      m_build_parent_list(np);  // lookups leave the child->parent list untouched
+    m_add_count(np, 1);
+  }
 }
 
 //-------------------------------  m_branch_insert()  ----------------------------------//
@@ -887,14 +2467,14 @@ template <class Key, class Base, class Compare, class Allocator>
 void
 mbt_base<Key,Base,Compare,Allocator>::
 m_branch_insert(key_type&& k, node* old_np, node* new_np)
-    // Effects:  inserts k and new_np at old_np->parent_element()->second and
-    //           (old_np->parent_element()+1)->first, respectively
+    // Effects:  inserts k as the key following old_np in its parent, and new_np as
+    //           the child following k
     // Postcondition: For the nodes pointed to by old_np and new_np, parent_node() and
-    //           parent_element() are valid. i.e. updated if needed
+    //           parent_index() are valid. i.e. updated if needed
 {
   branch_node*   old_node = old_np->parent_node();
   branch_node*   insert_node = old_node;
-  branch_value*  insert_begin = old_np->parent_element();
+  std::size_t    insert_index = old_np->parent_index();  // of k; new_np follows it
   branch_node*   new_node = 0;
 
   //std::cout << "*****branch insert, height=" << old_node->height() << "\n";
@@ -909,82 +2489,81 @@ m_branch_insert(key_type&& k, node* old_np, node* new_np)
 
     new_node = m_new_node<branch_node>(old_node->height(), m_max_branch_size);
 
-//    // ck pack conditions now, since leaf seq list update may chg header().last_node_id()
-//    if (m_ok_to_pack
-//        && (insert_begin != old_node->leaf().end() || old_node->node_id() != header().last_node_id()))
-//      m_ok_to_pack = false;  // conditions for pack optimization not met
-//
-//    // apply pack optimization if applicable
-//    if (m_ok_to_pack)  // have all inserts been ordered and no erases occurred?
-//    {
-//      // pack optimization: instead of splitting old_node, just put value alone on old_node2
-//      m_memcpy_value(&*old_node2->leaf().begin(), &key_, key_size, &mapped_value_, mapped_size);  // insert value
-//      old_node2->size(value_size);
-//      BOOST_ASSERT(old_node->parent()->node_id() == old_node->parent_node_id()); // max_cache_size logic OK?
-//      m_branch_insert(old_node->parent(), old_node->parent_element(),
-//        key(*old_node2->leaf().begin()), old_node2->node_id());
-//      ++m_size;
-//      return const_iterator(old_node2, old_node2->leaf().begin());
-//    }
-
-    // split node old_node by moving half the elements to node new_node
-    new_node->size(old_node->size() / 2);  // round down to minimize move size
-    detail::placement_move(old_node->end() - new_node->size(), old_node->end(),
-      new_node->begin());
-    new_node->end()->first = old_node->end()->first; // copy the end pseudo-element
-    old_node->size(old_node->size() - (new_node->size()+1));
-//    cout << "\nupdated old_node->size()=" << old_node->size() << '\n';
-
-    // Do the promotion now, since old_node->end().second is the key that needs to be
-    // promoted regardless of which node the insert occurs on.
-    m_branch_insert(std::move(old_node->end()->second), old_node, new_node);
-    old_node->end()->second.~key_type();  // prep for insert expects uninitialized memory
-
-    // TODO: if the insert point will fall on the new node, it would be faster to
-    // move the portion before the insert point, copy the value being inserted, and
-    // finally move the portion after the insert point. However, that's a fair amount of
-    // additional code for something that only happens on half of branch splits on average.
-
-    // adjust old_node and insert_begin if they now fall on the new node due to the split
-    if (insert_begin > old_node->end())
-    {
-//      cout << "\ninsert_begin offset=" << insert_begin - old_node->end() - 1 << endl;
-      BOOST_ASSERT((insert_begin-old_node->end()-1) >= 0);  // ck offset validity
-      BOOST_ASSERT((insert_begin-old_node->end()-1) <= static_cast<std::ptrdiff_t>(new_node->size()));
+    // likewise, m_append() extends the right edge of the branches with
+    // m_bulk_append(), so they stay full too
 
-      insert_begin = new_node->begin() + (insert_begin - old_node->end() - 1);
-      insert_node = new_node;
+    // split node old_node by moving half the keys and the children that follow them to
+    // node new_node, rounding down to minimize move size
+    std::size_t size = old_node->size();
+    std::size_t new_size = size / 2;
+    std::size_t split_point = size - new_size;
+    old_node->size(split_point - 1);
 
-      // update old_np's parent pointers
-      old_np->parent_node(insert_node);
-      old_np->parent_element(insert_begin);
+    // Do the promotion now, since the key preceding split_point is the key that needs
+    // to be promoted regardless of which node the insert occurs on.
+    m_branch_insert(std::move(*old_node->end()), old_node, new_node);
+    old_node->end()->~key_type();  // prep for insert expects uninitialized memory
+
+    if (insert_index >= split_point)
+    {
+      // the insert point falls on new_node, so construct k and new_np in place as the
+      // elements are distributed, rather than moving the elements after it twice
+      std::size_t i = insert_index - split_point;
+      key_type* p = detail::placement_move(old_node->begin() + split_point,
+        old_node->begin() + insert_index, new_node->begin());
+      ::new (p) key_type(std::move(k));
+      detail::placement_move(old_node->begin() + insert_index,
+        old_node->begin() + size, p+1);
+      child_slot* c = detail::move_range(old_node->children() + split_point,
+        old_node->children() + insert_index + 1, new_node->children());
+      slot_ptr(*c) = new_np;
+      detail::move_range(old_node->children() + insert_index + 1,
+        old_node->children() + size + 1, c+1);
+      new_node->size(new_size + 1);
+
+      // update old_np's and new_np's parent pointers
+      old_np->parent_node(new_node);
+      old_np->parent_index(i);
+      new_np->parent_node(new_node);
+      new_np->parent_index(i+1);
+      m_reindex(old_node);
+      m_reindex(new_node);
+      return;
     }
-  }
 
-  BOOST_ASSERT(insert_begin >= insert_node->begin());
-  BOOST_ASSERT(insert_begin <= insert_node->end());
+    detail::placement_move(old_node->begin() + split_point, old_node->begin() + size,
+      new_node->begin());
+    detail::move_range(old_node->children() + split_point,
+      old_node->children() + size + 1, new_node->children());
+    new_node->size(new_size);
+  }
 
-  // prep memory at end()->second for use
-  ::new (&insert_node->end()->second) key_type;
+  BOOST_ASSERT(insert_index <= insert_node->size());
 
-  // make room for insert
-  if (insert_begin != insert_node->end())
+  // make room for insert, moving each key and child pointer after the insert point once
+  key_type* insert_begin = insert_node->begin() + insert_index;
+  key_type* last = insert_node->end();
+  if (insert_begin == last)
+    ::new (last) key_type(std::move(k));
+  else
   {
-    (insert_node->end()+1)->first = insert_node->end()->first;  // end pseudo-element
-    std::move_backward(insert_begin+1, insert_node->end(), insert_node->end()+1);
-    (insert_begin+1)->second = std::move(insert_begin->second);  // key
+    ::new (last) key_type(std::move(*(last-1)));
+    detail::move_range_backward(insert_begin, last-1, last);
+    *insert_begin = std::move(k);
   }
-
-  //  insert x
-  insert_begin->second = k;
-  (insert_begin+1)->first = new_np;
+  child_slot* c = insert_node->children() + insert_index + 1;
+  detail::move_range_backward(c, insert_node->children() + insert_node->size() + 1,
+    insert_node->children() + insert_node->size() + 2);
+  slot_ptr(*c) = new_np;
   ++insert_node->_size;
 
   // update new_np's parent pointers
   new_np->parent_node(insert_node);
-  new_np->parent_element(insert_begin+1);
+  new_np->parent_index(insert_index + 1);
 
-  //std::cout << "*****branch insert done" << std::endl;
+  m_reindex(insert_node);
+  if (new_node)
+    m_reindex(new_node);
 }
 
 //------------------------------------- erase() ----------------------------------------//
@@ -1000,17 +2579,20 @@ erase(const_iterator pos)
   BOOST_ASSERT(pos.m_element < pos.m_node->end());
   BOOST_ASSERT(pos.m_element >= pos.m_node->begin());
 
-  //m_ok_to_pack = false;  // TODO: is this too conservative?
-
   --m_size;
 
   if (!pos.m_node->is_root()  // not root?
     && (pos.m_node->size() == 1))  // only 1 element on node?
   {
     // erase a single value leaf node that is not the root
-    leaf_node* nxt (pos.m_node->next_node(pos.m_node));
-    iterator nxt_it (nxt->is_root() ? end() : iterator(nxt, nxt->begin()));  // [note 1]
+    leaf_node* nxt (pos.m_node->next_leaf());
+    iterator nxt_it (nxt ? iterator(nxt, nxt->begin()) : end());  // [note 1]
+    m_build_parent_list(pos.m_node);  // lookups and iteration don't create it
+    pos.m_node->begin()->~leaf_value();
+    pos.m_node->size(0);  // so any summaries recomputed exclude the element
+    m_add_count(pos.m_node, -1);
     m_erase_from_parent(pos.m_node);  // unlink from tree
+    m_unlink_leaf(pos.m_node);
     m_free_node(pos.m_node);
     return nxt_it;
   }
@@ -1019,19 +2601,214 @@ erase(const_iterator pos)
     // erase an element from a leaf with multiple elements or erase the only element
     // on a leaf that is also the root; these use the same logic because they do not remove
     // the node from the tree.
-    std::move(pos.m_element+1, pos.m_node->end(), pos.m_element);
-    pos.m_node->size(pos.m_node->size()-1);
-    pos.m_node->end()->~leaf_value();
-    if (pos.m_element != pos.m_node->end())
-      return iterator(pos.m_node, pos.m_element);
-
-    leaf_node* nxt (pos.m_node->next_node(pos.m_node));
-    return nxt->is_root() ? end() : iterator(nxt, nxt->begin());
+    leaf_node* np = pos.m_node;
+    leaf_value* ep = pos.m_element;
+    detail::move_range(ep+1, np->end(), ep);
+    np->size(np->size()-1);
+    np->end()->~leaf_value();
+
+    bool rebalance = np->size() < m_min_leaf_size && !np->is_root();
+    if (rebalance || (counted_branches::value && np != m_last_leaf))
+      m_build_parent_list(np);  // np isn't empty, so this finds it
+    m_add_count(np, -1);
+    if (rebalance)
+      m_rebalance(np, ep);
+
+    if (ep != np->end())
+      return iterator(np, ep);
+
+    leaf_node* nxt (np->next_leaf());
+    return nxt ? iterator(nxt, nxt->begin()) : end();
   }
 }
 // [note 1] the call to m_erase_parent() may change the root, so build the next iterator
 //          before the call to m_erase_parent()
 
+//--------------------------------- m_rebalance() --------------------------------------//
+
+template <class Key, class Base, class Compare, class Allocator>
+void
+mbt_base<Key,Base,Compare,Allocator>::
+m_rebalance(leaf_node*& np, leaf_value*& ep)
+{
+  branch_node* parent = np->parent_node();
+  std::size_t pi = np->parent_index();
+  std::size_t sep;  // index of the key that separates left from right
+  leaf_node* left;
+  leaf_node* right;
+
+  if (pi != 0)
+  {
+    sep = pi - 1;
+    left = node_cast<leaf_node>(parent->child(sep));
+    right = np;
+  }
+  else if (pi != parent->size())
+  {
+    sep = pi;
+    left = np;
+    right = node_cast<leaf_node>(parent->child(pi+1));
+  }
+  else
+    return;  // np is an only child
+
+  BOOST_ASSERT(left->next_leaf() == right);
+  size_type l = left->size();
+  size_type r = right->size();
+
+  if (l + r <= m_max_leaf_size)
+  {
+    // merge right into left
+    detail::placement_move(right->begin(), right->end(), left->end());
+    left->size(l + r);
+    right->size(0);
+    if (np == right)
+    {
+      ep = left->begin() + l + (ep - right->begin());
+      np = left;
+    }
+    m_unlink_leaf(right);
+    m_recount_child(parent, sep);
+    m_erase_merged(right, parent, sep + 1);
+    m_free_node(right);
+    return;
+  }
+
+  // borrow, leaving the two nodes evenly filled
+  if (np == left)
+  {
+    size_type k = (r - l) / 2;
+    detail::placement_move(right->begin(), right->begin() + k, left->end());
+    left->size(l + k);
+    detail::placement_move(right->begin() + k, right->end(), right->begin());
+    right->size(r - k);
+  }
+  else
+  {
+    size_type k = (l - r) / 2;
+    detail::placement_move_backward(right->begin(), right->end(), right->end() + k);
+    detail::placement_move(left->end() - k, left->end(), right->begin());
+    left->size(l - k);
+    right->size(r + k);
+    ep += k;
+  }
+  parent->key(sep) = key(*right->begin());
+  m_reindex(parent);
+  m_recount_child(parent, sep);
+  m_recount_child(parent, sep + 1);
+}
+
+template <class Key, class Base, class Compare, class Allocator>
+void
+mbt_base<Key,Base,Compare,Allocator>::
+m_rebalance(branch_node* np)
+{
+  branch_node* parent = np->parent_node();
+  std::size_t pi = np->parent_index();
+  std::size_t sep;  // index of the key that separates left from right
+  branch_node* left;
+  branch_node* right;
+
+  if (pi != 0)
+  {
+    sep = pi - 1;
+    left = node_cast<branch_node>(parent->child(sep));
+    right = np;
+  }
+  else if (pi != parent->size())
+  {
+    sep = pi;
+    left = np;
+    right = node_cast<branch_node>(parent->child(pi+1));
+  }
+  else
+    return;  // np is an only child
+
+  size_type l = left->size();
+  size_type r = right->size();
+
+  //  Keys rotate through the parent, since a branch has one more child than keys.
+  //  Example: borrowing two children for left; sep's key is D
+  //  Before: left: 1:A 2      right: 3:E 4:F 5:G 6      parent: ...left:D right...
+  //  After:  left: 1:A 2:D 3  right: 5:G 6              parent: ...left:F right...
+
+  if (l + r + 1 <= m_max_branch_size)
+  {
+    // merge right into left, bringing down sep's key
+    ::new (left->end()) key_type(std::move(parent->key(sep)));
+    detail::placement_move(right->begin(), right->end(), left->end() + 1);
+    detail::move_range(right->children(), right->children() + r + 1,
+      left->children() + l + 1);
+    left->size(l + 1 + r);
+    right->size(0);
+    m_reindex(left);
+    m_recount_child(parent, sep);
+    m_erase_merged(right, parent, sep + 1);
+    m_free_node(right);
+    return;
+  }
+
+  size_type k = (np == left ? r - l : l - r) / 2;  // borrow, evenly filling both
+  if (k == 0)
+    return;
+
+  if (np == left)
+  {
+    ::new (left->end()) key_type(std::move(parent->key(sep)));
+    detail::placement_move(right->begin(), right->begin() + (k-1), left->end() + 1);
+    detail::move_range(right->children(), right->children() + k,
+      left->children() + l + 1);
+    left->size(l + k);
+    key_type* last = right->begin() + (k-1);
+    parent->key(sep) = std::move(*last);
+    last->~key_type();
+    detail::placement_move(right->begin() + k, right->end(), right->begin());
+    detail::move_range(right->children() + k, right->children() + r + 1,
+      right->children());
+    right->size(r - k);
+  }
+  else
+  {
+    detail::placement_move_backward(right->begin(), right->end(), right->end() + k);
+    detail::move_range_backward(right->children(), right->children() + r + 1,
+      right->children() + r + k + 1);
+    ::new (right->begin() + (k-1)) key_type(std::move(parent->key(sep)));
+    detail::placement_move(left->end() - (k-1), left->end(), right->begin());
+    detail::move_range(left->children() + (l-k+1), left->children() + l + 1,
+      right->children());
+    key_type* last = left->end() - k;  // precedes left's new last child
+    parent->key(sep) = std::move(*last);
+    last->~key_type();
+    left->size(l - k);
+    right->size(r + k);
+  }
+  m_reindex(left);
+  m_reindex(right);
+  m_reindex(parent);
+  m_recount_child(parent, sep);
+  m_recount_child(parent, sep + 1);
+}
+
+//-------------------------------- m_erase_merged() ------------------------------------//
+
+template <class Key, class Base, class Compare, class Allocator>
+void
+mbt_base<Key,Base,Compare,Allocator>::
+m_erase_merged(node* right, branch_node* parent, std::size_t right_index)
+{
+  right->parent_node(parent);
+  right->parent_index(right_index);
+
+  if (parent->is_root())
+    m_erase_from_parent(right);  // may trim the tree, freeing parent
+  else
+  {
+    m_erase_from_parent(right);
+    if (parent->size() < m_min_branch_size)
+      m_rebalance(parent);
+  }
+}
+
 //------------------------------ m_erase_branch_value() --------------------------------//
 
 template <class Key, class Base, class Compare, class Allocator>
@@ -1040,11 +2817,10 @@ mbt_base<Key,Base,Compare,Allocator>::
 m_erase_from_parent(node* child)
 {
   branch_node* np (child->parent_node());
-  branch_value* ep (child->parent_element());
+  std::size_t i (child->parent_index());
 
   BOOST_ASSERT(np->is_branch());
-  BOOST_ASSERT(ep >= np->begin());
-  BOOST_ASSERT(ep <= np->end());  // may be end pseudo-element
+  BOOST_ASSERT(i <= np->size());  // may be the last child
 
   //  Example 1:
   //
@@ -1055,7 +2831,7 @@ m_erase_from_parent(node* child)
   //                    A...        C...   leaves, height 0
 
   if (np->is_empty())
-  // If the node is empty, except for the end pseudo-element, then just unlink from
+  // If the node is empty, except for its only child, then just unlink from
   // parent and free node. This will happen for a height 1 branch in the example
   // if the last element its child leaf is erased.
   {
@@ -1065,41 +2841,110 @@ m_erase_from_parent(node* child)
     return;
   }
 
-  if (ep != np->end())
-  {
-    if (ep != np->begin())
-    // Process erase of element other than the first element (ie preserve branch invariants)
-    // Example 2: erase with ep pointing to element 2:B below
-    // Branch:        1:A 2:B 3:C 4:D 5
-    // Postcondition: 1:B 3:C 4:D 5
-    {
-      (ep-1)->second = std::move(ep->second);
-    }
-
-    std::move(ep+1, np->end(), ep);
-    (np->end()-1)->first = np->end()->first;
-  }
-
-  // common processing for all non-empty nodes
-  (np->end()-1)->second.~key_type();
+  // Erase the child and the key preceding it, or if it is the first child, the key
+  // following it (ie preserve branch invariants)
+  // Example 2: erase child 2 below
+  // Branch:        1:A 2:B 3:C 4:D 5
+  // Postcondition: 1:B 3:C 4:D 5
+  key_type* kp = np->begin() + (i ? i-1 : 0);
+  detail::move_range(kp+1, np->end(), kp);
+  (np->end()-1)->~key_type();
+  detail::move_range(np->children() + i + 1, np->children() + np->size() + 1,
+    np->children() + i);
   np->size(np->size()-1);
+  m_reindex(np);
 
   // Trim the tree if applicable. In Example 1 above, if the last element on either of
   // the leaves is erased, then all the branch nodes must be removed and the remaining
   // leaf node becomes the new root.
-  while (np->is_empty()      // node is empty except for the end pseudo-element
+  while (np->is_empty()      // node is empty except for its only child
          && np->is_root()    // node is the root
          && !np->is_leaf())  // node isn't a leaf (happens if iteration reaches a leaf)
   {
-    // make the end pseudo-element the new root and then free this node
-    m_root = np->end()->first;
+    // make the only child the new root and then free this node
+    m_root = np->child(0);
     m_root->parent_node(0);
-    m_root->owner(this);
+    m_root->parent_index(0);
     m_free_node(np);
     np = node_cast<branch_node>(m_root);
   }
 }
 
+//----------------------------- m_build_parent_list() ----------------------------------//
+
+template <class Key, class Base, class Compare, class Allocator>
+void
+mbt_base<Key,Base,Compare,Allocator>::
+m_build_parent_list(leaf_node* np)
+{
+  BOOST_ASSERT(!np->is_empty());
+
+  key_type k = key(*np->begin());  // copy; key() would bind to a converted temporary
+  branch_node* bp = node_cast<branch_node>(m_root);
+
+  // descend to the leftmost leaf that may contain k
+  while (bp->is_branch())
+  {
+    std::size_t low = m_lower_bound(bp, k);
+
+    // create the child->parent list
+    node* child = bp->child(low);
+    m_prefetch(child, bp->height() - 1);
+    child->parent_node(bp);
+    child->parent_index(low);
+
+    bp = node_cast<branch_node>(child);
+  }
+
+  // with the unique branch invariant or duplicate keys, np may follow that leaf
+  leaf_node* lp = node_cast<leaf_node>(bp);
+  while (lp != np)
+  {
+    lp = lp->next_node(lp);  // extends the child->parent list
+    BOOST_ASSERT(!lp->is_root());
+  }
+}
+
+//--------------------------------- m_link_leaf() --------------------------------------//
+
+template <class Key, class Base, class Compare, class Allocator>
+void
+mbt_base<Key,Base,Compare,Allocator>::
+m_link_leaf(leaf_node* np, leaf_node* new_np)
+{
+  new_np->_prior_leaf = np;
+  new_np->_next_leaf = np->_next_leaf;
+  if (np->_next_leaf)
+    np->_next_leaf->_prior_leaf = new_np;
+  else
+  {
+    m_last_leaf = new_np;
+    new_np->owner(this);
+  }
+  np->_next_leaf = new_np;
+}
+
+//-------------------------------- m_unlink_leaf() -------------------------------------//
+
+template <class Key, class Base, class Compare, class Allocator>
+void
+mbt_base<Key,Base,Compare,Allocator>::
+m_unlink_leaf(leaf_node* np)
+{
+  if (np->_prior_leaf)
+    np->_prior_leaf->_next_leaf = np->_next_leaf;
+  else
+    m_first_leaf = np->_next_leaf;
+
+  if (np->_next_leaf)
+    np->_next_leaf->_prior_leaf = np->_prior_leaf;
+  else
+  {
+    m_last_leaf = np->_prior_leaf;
+    m_last_leaf->owner(this);
+  }
+}
+
 template <class Key, class Base, class Compare, class Allocator>
 typename mbt_base<Key,Base,Compare,Allocator>::size_type
 mbt_base<Key,Base,Compare,Allocator>::
@@ -1119,19 +2964,559 @@ erase(const key_type& k)
 template <class Key, class Base, class Compare, class Allocator>
 typename mbt_base<Key,Base,Compare,Allocator>::iterator
 mbt_base<Key,Base,Compare,Allocator>::
-erase(const_iterator first, const_iterator last)
+erase(const_iterator first, const_iterator last)
+{
+  if (first == last)
+    return iterator(last);
+  if (first == begin() && last == end())
+  {
+    clear();
+    return end();
+  }
+
+  leaf_node*  lf = first.m_node;
+  leaf_node*  ll = last.m_node;  // 0 if last is end()
+  leaf_value* ep = first.m_element;
+
+  if (lf == ll || lf == m_root)
+  {
+    // within one leaf; as for erasing a single element
+    leaf_value* lep = ll ? last.m_element : lf->end();
+    std::size_t n = lep - ep;
+    detail::move_range(lep, lf->end(), ep);
+    for (leaf_value* p = lf->end() - n; p != lf->end(); ++p)
+      p->~leaf_value();
+    lf->size(lf->size() - n);
+    m_size -= n;
+
+    bool rebalance = lf->size() < m_min_leaf_size && !lf->is_root();
+    if (rebalance || (counted_branches::value && lf != m_last_leaf))
+      m_build_parent_list(lf);  // lf isn't empty, so this finds it
+    m_add_count(lf, -static_cast<difference_type>(n));
+    if (rebalance)
+      m_rebalance(lf, ep);
+
+    if (ep != lf->end())
+      return iterator(lf, ep);
+    leaf_node* nxt (lf->next_leaf());
+    return nxt ? iterator(nxt, nxt->begin()) : end();
+  }
+
+  m_build_parent_list(lf);  // lookups and iteration don't create it
+  if (ll)
+    m_build_parent_list(ll);
+
+  // trim the boundary leaves
+  size_type n = lf->end() - ep;
+  for (leaf_value* p = ep; p != lf->end(); ++p)
+    p->~leaf_value();
+  lf->size(ep - lf->begin());
+  if (ll && last.m_element != ll->begin())
+  {
+    std::size_t k = last.m_element - ll->begin();
+    detail::move_range(last.m_element, ll->end(), ll->begin());
+    for (leaf_value* p = ll->end() - k; p != ll->end(); ++p)
+      p->~leaf_value();
+    ll->size(ll->size() - k);
+    n += k;
+  }
+
+  // Free everything between them. Climbing from the leaves, each ancestor of lf loses
+  // the children after the one leading to lf, and each ancestor of ll those before the
+  // one leading to ll, until the two meet. If last is end(), lf's ancestors are trimmed
+  // up to the root. Separators that remain still bound their children, since the
+  // elements that remain are those already between them.
+  node* left = lf;
+  node* right = ll;
+  for (;;)
+  {
+    branch_node* parent = left->parent_node();
+    std::size_t  i = left->parent_index();
+    if (right && right->parent_node() == parent)
+    {
+      n += m_erase_children(parent, i + 1, right->parent_index());
+      right->parent_index(i + 1);
+      break;
+    }
+    n += m_erase_children(parent, i + 1, parent->size() + 1);
+    if (right)
+    {
+      n += m_erase_children(right->parent_node(), 0, right->parent_index());
+      right->parent_index(0);
+      right = right->parent_node();
+    }
+    if (parent->is_root())
+      break;
+    left = parent;
+  }
+  m_size -= n;
+  m_recount_ancestors(lf);
+  if (ll)
+    m_recount_ancestors(ll);
+
+  lf->_next_leaf = ll;
+  if (ll)
+    ll->_prior_leaf = lf;
+  else
+  {
+    m_last_leaf = lf;
+    lf->owner(this);
+  }
+
+  // the element that follows the erased ones, tracked as rebalancing moves it
+  leaf_node*  np = ll;
+  leaf_value* rp = ll ? ll->begin() : 0;
+
+  if (lf->is_empty())
+  {
+    // lf's ancestors only lost children after lf, so its child->parent list holds
+    m_erase_from_parent(lf);
+    m_unlink_leaf(lf);
+    m_free_node(lf);
+    lf = 0;
+  }
+
+  m_trim_root();
+
+  // If lf borrows from or merges with ll, the elements that come to follow lf's are
+  // ll's first, so track lf's end. Evenly filling both leaves by a borrow leaves
+  // neither underfull, so then ll doesn't need rebalancing.
+  if (lf && lf->size() < m_min_leaf_size && !lf->is_root())
+  {
+    leaf_value* lep = lf->end();
+    m_build_parent_list(lf);
+    m_rebalance(lf, lep);
+    if (lep != lf->end())
+    {
+      np = lf;
+      rp = lep;
+    }
+  }
+  if (np == ll && ll && ll->size() < m_min_leaf_size && !ll->is_root())
+  {
+    m_build_parent_list(ll);
+    m_rebalance(np, rp);
+  }
+
+  leaf_node* lp = np ? np->prior_leaf() : m_last_leaf;
+  if (lp)
+    m_rebalance_ancestors(lp);
+  if (np)
+    m_rebalance_ancestors(np);
+
+  return np ? iterator(np, rp) : end();
+}
+
+template <class Key, class Base, class Compare, class Allocator>
+typename mbt_base<Key,Base,Compare,Allocator>::size_type
+mbt_base<Key,Base,Compare,Allocator>::
+erase_before(const key_type& k)
+{
+  size_type sz = size();
+  erase(begin(), lower_bound(k));
+  return sz - size();
+}
+
+template <class Key, class Base, class Compare, class Allocator>
+typename mbt_base<Key,Base,Compare,Allocator>::size_type
+mbt_base<Key,Base,Compare,Allocator>::
+erase_after(const key_type& k)
+{
+  size_type sz = size();
+  erase(upper_bound(k), end());
+  return sz - size();
+}
+
+//-----------------------------------  split_at()  -------------------------------------//
+
+template <class Key, class Base, class Compare, class Allocator>
+void
+mbt_base<Key,Base,Compare,Allocator>::
+split_at(const key_type& k, mbt_base<Key,Base,Compare,Allocator>& tail)
+{
+  BOOST_ASSERT_MSG(&tail != this, "split_at() into the container itself");
+
+  tail.clear();
+  iterator pos = lower_bound(k);
+  if (pos == end())
+    return;
+
+  if (node_size() != tail.node_size() || !(m_alloc == tail.m_alloc))
+  {
+    // nodes can't change containers, so the elements do
+    for (leaf_node* lp = pos.m_node; lp; lp = lp->next_leaf())
+      for (leaf_value* ep = lp == pos.m_node ? pos.m_element : lp->begin();
+        ep != lp->end(); ++ep)
+        tail.m_append(value_type(std::move(*ep)));
+    erase(pos, end());
+    return;
+  }
+
+  // tail will hold nodes carved from m_pool's slabs, so the two share them
+  tail.m_free_node(node_cast<leaf_node>(tail.m_root));
+  m_share_pool(tail.m_pool);
+
+  leaf_node* lf = pos.m_node;
+  m_build_parent_list(lf);  // lookups leave the child->parent list untouched
+
+  // Cut the leaf, then climb the path to the root, cutting each ancestor in two: the
+  // part before the cut stays in place, and the part from the cut on, headed by the
+  // right half of the cut below, goes to a new node for tail. The key preceding the
+  // path's child separates that right half from the children that follow it, so it
+  // goes along. A part that would be empty is freed instead; only the left can be.
+  node* left = lf;
+  node* right = lf;
+  if (pos.m_element == lf->begin())
+    left = 0;
+  else
+  {
+    leaf_node* rp = tail.m_new_node<leaf_node>(0U, m_max_leaf_size);
+    std::size_t n = lf->end() - pos.m_element;
+    detail::placement_move(pos.m_element, lf->end(), rp->begin());
+    rp->size(n);
+    lf->size(lf->size() - n);
+    rp->_next_leaf = lf->_next_leaf;
+    if (rp->_next_leaf)
+      rp->_next_leaf->_prior_leaf = rp;
+    else
+      m_last_leaf = rp;
+    lf->_next_leaf = rp;
+    right = rp;
+  }
+  leaf_node* tail_first = node_cast<leaf_node>(right);
+  leaf_node* tail_last = m_last_leaf;
+  leaf_node* last = left ? lf : lf->prior_leaf();  // 0 if everything goes to tail
+
+  branch_node* parent = lf->parent_node();
+  std::size_t i = lf->parent_index();
+  for (branch_node* up; parent; parent = up)
+  {
+    std::size_t sz = parent->size();
+    std::size_t up_i = parent->parent_index();
+    up = parent->parent_node();  // before parent may be freed
+
+    branch_node* bp = tail.m_new_node<branch_node>(parent->height(), m_max_branch_size);
+    detail::placement_move(parent->begin() + i, parent->end(), bp->begin());
+    detail::move_range(parent->children() + i + 1, parent->children() + sz + 1,
+      bp->children() + 1);
+    bp->child(0) = right;
+    bp->size(sz - i);
+    m_recount_child(bp, 0);
+    m_reindex(bp);
+    right = bp;
+
+    if (left || i != 0)
+    {
+      if (left)
+      {
+        parent->size(i);
+        m_recount_child(parent, i);
+      }
+      else
+      {
+        parent->size(i - 1);
+        parent->end()->~key_type();  // preceded the child that went to tail
+      }
+      m_reindex(parent);
+      left = parent;
+    }
+    else
+    {
+      parent->size(0);  // its keys and children all went to tail
+      m_free_node(parent);
+    }
+    i = up_i;
+  }
+
+  tail.m_root = right;
+  tail.m_first_leaf = tail_first;
+  tail.m_last_leaf = tail_last;
+  tail_first->_prior_leaf = 0;
+  tail_last->owner(&tail);
+
+  // The two pools' tallies together count the nodes of both trees. Tally the tree
+  // with fewer children at the root, likely the smaller, and subtract for the other.
+  size_type nodes = m_pool.nodes + tail.m_pool.nodes;
+  size_type n = m_size;
+  if (left && left->size() < right->size())
+  {
+    m_pool.nodes = 0;
+    m_size = m_tally(left, m_pool.nodes, counted_branches());
+    tail.m_pool.nodes = nodes - m_pool.nodes;
+    tail.m_size = n - m_size;
+  }
+  else
+  {
+    tail.m_pool.nodes = 0;
+    tail.m_size = m_tally(right, tail.m_pool.nodes, counted_branches());
+    m_pool.nodes = nodes - tail.m_pool.nodes;
+    m_size = n - tail.m_size;
+  }
+
+  if (left)
+  {
+    m_root = left;
+    m_last_leaf = last;
+    last->_next_leaf = 0;
+    last->owner(this);
+  }
+  else
+    m_init();  // the cut preceded every element
+
+  m_trim_root();
+  tail.m_trim_root();
+  if (left)
+    m_rebalance_edge(m_last_leaf);
+  tail.m_rebalance_edge(tail.m_first_leaf);
+}
+
+//-------------------------------------  join()  ---------------------------------------//
+
+template <class Key, class Base, class Compare, class Allocator>
+void
+mbt_base<Key,Base,Compare,Allocator>::
+join(mbt_base<Key,Base,Compare,Allocator>& tail)
+{
+  BOOST_ASSERT_MSG(&tail != this, "join() with the container itself");
+
+  if (tail.empty())
+    return;
+  BOOST_ASSERT_MSG(m_at_right_edge(
+    key(*reinterpret_cast<const value_type*>(tail.m_first_leaf->begin()))),
+    "join() requires the elements of tail to follow those of *this");
+
+  if (node_size() != tail.node_size() || !(m_alloc == tail.m_alloc))
+  {
+    // nodes can't change containers, so the elements do
+    for (leaf_node* lp = tail.m_first_leaf; lp; lp = lp->next_leaf())
+      for (leaf_value* ep = lp->begin(); ep != lp->end(); ++ep)
+        m_append(value_type(std::move(*ep)));
+    tail.clear();
+    return;
+  }
+
+  node* root = tail.m_root;
+  leaf_node* first = tail.m_first_leaf;
+  leaf_node* last = tail.m_last_leaf;
+  size_type n = tail.m_size;
+  m_splice_pool(tail.m_pool);  // tail's nodes are now *this's
+  tail.m_init();
+
+  if (empty())
+  {
+    m_free_node(node_cast<leaf_node>(m_root));
+    m_root = root;
+    m_first_leaf = first;
+    m_last_leaf = last;
+    last->owner(this);
+    m_size = n;
+    return;
+  }
+
+  key_type k = key(*reinterpret_cast<const value_type*>(first->begin()));
+  m_last_leaf->_next_leaf = first;
+  first->_prior_leaf = m_last_leaf;
+  m_last_leaf = last;
+  last->owner(this);
+  m_size += n;
+
+  // Graft the shorter tree onto the facing edge of the taller, as the sibling of the
+  // edge node of its own height, so that the leaves all stay at one depth. k, which
+  // no element of *this follows and none of tail precedes, separates the two.
+  node* graft;  // the shorter root
+  node* edge;   // its sibling
+  if (m_root->height() >= root->height())
+  {
+    if (m_root->height() == root->height())
+      m_new_root();
+    edge = m_root;
+    while (edge->height() > root->height())
+    {
+      branch_node* bp = node_cast<branch_node>(edge);
+      edge = bp->child(bp->size());
+      edge->parent_node(bp);
+      edge->parent_index(bp->size());
+    }
+    graft = root;
+    m_branch_insert(std::move(k), edge, graft);
+  }
+  else
+  {
+    graft = m_root;
+    m_root = root;
+    edge = m_root;
+    while (edge->height() > graft->height())
+    {
+      branch_node* bp = node_cast<branch_node>(edge);
+      edge = bp->child(0);
+      edge->parent_node(bp);
+      edge->parent_index(0);
+    }
+
+    // graft takes edge's place as the first child, and edge follows it
+    branch_node* bp = edge->parent_node();
+    bp->child(0) = graft;
+    graft->parent_node(bp);
+    graft->parent_index(0);
+    m_branch_insert(std::move(k), graft, edge);
+  }
+  m_recount_ancestors(graft, true);  // edge is adjacent, as are halves of any split
+
+  // a root may have been underfull, and may now be neither root nor as full as a
+  // node needs to be; rebalancing either against the other evenly fills both
+  node* np = graft->size() < (graft->is_leaf() ? m_min_leaf_size : m_min_branch_size)
+    ? graft : edge;
+  if (np->size() >= (np->is_leaf() ? m_min_leaf_size : m_min_branch_size))
+    return;
+  if (np->is_leaf())
+  {
+    leaf_node* lp = node_cast<leaf_node>(np);
+    leaf_value* ep = lp->begin();
+    m_rebalance(lp, ep);
+  }
+  else
+    m_rebalance(node_cast<branch_node>(np));
+}
+
+//-------------------------------  m_erase_children()  ---------------------------------//
+
+template <class Key, class Base, class Compare, class Allocator>
+typename mbt_base<Key,Base,Compare,Allocator>::size_type
+mbt_base<Key,Base,Compare,Allocator>::
+m_erase_children(branch_node* bp, std::size_t first, std::size_t last)
+{
+  if (first == last)
+    return 0;
+
+  size_type n = 0;
+  for (std::size_t i = first; i != last; ++i)
+    n += m_free_subtree(bp->child(i));
+
+  // as m_erase_from_parent() does for one child, erase the key preceding each child,
+  // or if the first child is erased, the key following it
+  std::size_t count = last - first;
+  key_type* kp = bp->begin() + (first ? first - 1 : 0);
+  detail::move_range(kp + count, bp->end(), kp);
+  for (key_type* p = bp->end() - count; p != bp->end(); ++p)
+    p->~key_type();
+  detail::move_range(bp->children() + last, bp->children() + bp->size() + 1,
+    bp->children() + first);
+  bp->size(bp->size() - count);
+  m_reindex(bp);
+  return n;
+}
+
+//--------------------------------  m_free_subtree()  ----------------------------------//
+
+template <class Key, class Base, class Compare, class Allocator>
+typename mbt_base<Key,Base,Compare,Allocator>::size_type
+mbt_base<Key,Base,Compare,Allocator>::
+m_free_subtree(node* np)
+{
+  if (np->is_leaf())
+  {
+    size_type n = np->size();
+    m_free_node(node_cast<leaf_node>(np));
+    return n;
+  }
+
+  branch_node* bp = node_cast<branch_node>(np);
+  size_type n = 0;
+  for (std::size_t i = 0; i <= bp->size(); ++i)
+    n += m_free_subtree(bp->child(i));
+  m_free_node(bp);
+  return n;
+}
+
+//----------------------------  m_rebalance_ancestors()  -------------------------------//
+
+template <class Key, class Base, class Compare, class Allocator>
+void
+mbt_base<Key,Base,Compare,Allocator>::
+m_rebalance_ancestors(leaf_node* np)
+{
+  m_build_parent_list(np);
+  for (node* bp = np->parent_node(); bp && !bp->is_root(); bp = bp->parent_node())
+  {
+    if (bp->size() >= m_min_branch_size)
+      continue;
+    std::size_t height = bp->height();
+    m_rebalance(node_cast<branch_node>(bp));
+
+    // a merge may have freed bp, or trimmed the tree, so find np's ancestor afresh
+    m_build_parent_list(np);
+    for (bp = np; bp->height() < height && !bp->is_root(); bp = bp->parent_node())
+      {}
+  }
+}
+
+template <class Key, class Base, class Compare, class Allocator>
+void
+mbt_base<Key,Base,Compare,Allocator>::
+m_rebalance_edge(leaf_node* np)
+{
+  m_rebalance_ancestors(np);
+  if (np->size() < m_min_leaf_size && !np->is_root())
+  {
+    leaf_value* ep = np->begin();
+    m_build_parent_list(np);
+    m_rebalance(np, ep);
+  }
+}
+
+//---------------------------------  m_trim_root()  ------------------------------------//
+
+template <class Key, class Base, class Compare, class Allocator>
+void
+mbt_base<Key,Base,Compare,Allocator>::
+m_trim_root()
+{
+  while (m_root->is_branch() && m_root->is_empty())
+  {
+    branch_node* bp = node_cast<branch_node>(m_root);
+    m_root = bp->child(0);
+    m_root->parent_node(0);
+    m_root->parent_index(0);
+    m_free_node(bp);
+  }
+}
+
+//-----------------------------------  m_tally()  --------------------------------------//
+
+template <class Key, class Base, class Compare, class Allocator>
+typename mbt_base<Key,Base,Compare,Allocator>::size_type
+mbt_base<Key,Base,Compare,Allocator>::
+m_tally(node* np, size_type& nodes, std::false_type)
+{
+  ++nodes;
+  if (np->is_leaf())
+    return np->size();
+
+  branch_node* bp = node_cast<branch_node>(np);
+  size_type n = 0;
+  for (std::size_t i = 0; i <= bp->size(); ++i)
+    n += m_tally(bp->child(i), nodes, std::false_type());
+  return n;
+}
+
+template <class Key, class Base, class Compare, class Allocator>
+typename mbt_base<Key,Base,Compare,Allocator>::size_type
+mbt_base<Key,Base,Compare,Allocator>::
+m_tally(node* np, size_type& nodes, std::true_type)
 {
-  // caution: last must be revalidated when on the same node as first
-  while (first != last)
+  ++nodes;
+  if (np->is_leaf())
+    return np->size();
+
+  branch_node* bp = node_cast<branch_node>(np);
+  if (bp->height() == 1)
+    nodes += bp->size() + 1;  // the leaves, which the counts make it needless to visit
+  else
   {
-    if (last != end() && first.m_node == last.m_node)
-    {
-      BOOST_ASSERT(first.m_element < last.m_element);
-      --last;  // revalidate in anticipation of erasing a prior element on same node
-    }
-    first = erase(first);
+    for (std::size_t i = 0; i <= bp->size(); ++i)
+      m_tally(bp->child(i), nodes, std::true_type());
   }
-  return last;
+  return m_subtree_size(bp);
 }
 
 ////----------------------------------- m_sub_tree_begin() -------------------------------//
@@ -1173,31 +3558,33 @@ m_special_lower_bound(const key_type& k) const
   // search branches down the tree until a leaf is reached
   while (bp->is_branch())
   {
-    branch_value* low
-      = std::lower_bound(bp->begin(), bp->end(), k, branch_comp());
-
-    if ( /*(header().flags() & btree::flags::unique)
-      &&*/ low != bp->end()
-      && !key_comp()(k, low->second)) // if k isn't less that low key, low is equal
-      ++low;                         // and so must be incremented; this follows from
-                                     // the branch node invariant for unique containers
-
-    // create the child->parent list
-    node* child = low->first;
-    child->parent_node(bp);
-    child->parent_element(low);
-
-    bp = node_cast<branch_node>(child);
+    std::size_t low = m_lower_bound_child(bp, k);
+    m_prefetch(bp->child(low), bp->height() - 1);
+    bp = node_cast<branch_node>(bp->child(low));
   }
 
   //  search leaf
   leaf_node* lp = node_cast<leaf_node>(bp);
-  leaf_value* low
-    = std::lower_bound(lp->begin(), lp->end(), k, value_comp());
+  leaf_value* low = m_lower_bound(lp, k);
 
   return iterator(lp, low);
 }
 
+template <class Key, class Base, class Compare, class Allocator>
+std::size_t
+mbt_base<Key,Base,Compare,Allocator>::
+m_lower_bound_child(branch_node* bp, const key_type& k) const
+{
+  std::size_t low = m_lower_bound(bp, k);
+
+  if ( /*(header().flags() & btree::flags::unique)
+    &&*/ low != bp->size()
+    && !key_comp()(k, bp->key(low))) // if k isn't less that low key, low is equal
+    ++low;                         // and so must be incremented; this follows from
+                                   // the branch node invariant for unique containers
+  return low;
+}
+
 //---------------------------------- lower_bound() -------------------------------------//
 
 template <class Key, class Base, class Compare, class Allocator>
@@ -1205,20 +3592,37 @@ typename mbt_base<Key,Base,Compare,Allocator>::iterator
 mbt_base<Key,Base,Compare,Allocator>::
 lower_bound(const key_type& k)
 {
-  iterator low = m_special_lower_bound(k);
-
-  if (low.m_element != low.m_node->end())
-    return low;
+  return m_adjust_lower_bound(m_special_lower_bound(k), k);
+}
 
-  if (low.m_node->begin() == low.m_node->end())
+template <class Key, class Base, class Compare, class Allocator>
+typename mbt_base<Key,Base,Compare,Allocator>::iterator
+mbt_base<Key,Base,Compare,Allocator>::
+m_adjust_lower_bound(iterator low, const key_type& k)
+{
+  if (low.m_element == low.m_node->end())
   {
-    BOOST_ASSERT(empty());
-    return end();
+    if (low.m_node->begin() == low.m_node->end())
+    {
+      BOOST_ASSERT(empty());
+      return end();
+    }
+
+    // lower bound is first element on next node
+    leaf_node* np = low.m_node->next_leaf();
+    return np ? iterator(np, np->begin()) : end();
   }
 
-  // lower bound is first element on next node
-  leaf_node* np = low.m_node->next_node(low.m_node);
-  return !np->is_root() ? iterator(np, np->begin()) : end();
+  // In non-unique containers, elements equal to a branch key may also lie on leaves
+  // preceding the one the descent reaches, since a split or a borrow makes the first
+  // key of the right node the branch key whether or not it also ends the left node
+  while (low.m_element == low.m_node->begin() && low.m_node->prior_leaf()
+    && !key_comp()(key(*(low.m_node->prior_leaf()->end()-1)), k))
+  {
+    leaf_node* np = low.m_node->prior_leaf();
+    low = iterator(np, m_lower_bound(np, k));
+  }
+  return low;
 }
 
 //-----------------------------  m_special_upper_bound()  ------------------------------//
@@ -1233,21 +3637,14 @@ m_special_upper_bound(const key_type& k) const
   // search branches down the tree until a leaf is reached
   while (bp->is_branch())
   {
-    branch_value* up
-      = std::upper_bound(bp->begin(), bp->end(), k, branch_comp());
-
-    // create the child->parent list
-    node* child = up->first;
-    child->parent_node(bp);
-    child->parent_element(up);
-
-    bp = node_cast<branch_node>(child);
+    std::size_t up = m_upper_bound(bp, k);
+    m_prefetch(bp->child(up), bp->height() - 1);
+    bp = node_cast<branch_node>(bp->child(up));
   }
 
   //  search leaf
   leaf_node* lp = node_cast<leaf_node>(bp);
-  leaf_value* up
-    = std::upper_bound(lp->begin(), lp->end(), k, value_comp());
+  leaf_value* up = m_upper_bound(lp, k);
 
   return iterator(lp, up);
 }
@@ -1265,8 +3662,8 @@ upper_bound(const key_type& k)
     return up;
 
   // upper bound is first element on next node
-  leaf_node* np = up.m_node->next_node(up.m_node);
-  return !np->is_root() ? iterator(np, np->begin()) : end();
+  leaf_node* np = up.m_node->next_leaf();
+  return np ? iterator(np, np->begin()) : end();
 }
 
 //------------------------------------- find() -----------------------------------------//
@@ -1282,12 +3679,122 @@ find(const key_type& k)
     : end();
 }
 
+//----------------------------------- find_batch() -------------------------------------//
+
+template <class Key, class Base, class Compare, class Allocator>
+template <class ForwardIterator, class OutputIterator>
+OutputIterator
+mbt_base<Key,Base,Compare,Allocator>::
+find_batch(ForwardIterator first, ForwardIterator last, OutputIterator result)
+{
+  ForwardIterator keys[find_batch_group];
+  node* nodes[find_batch_group];
+
+  while (first != last)
+  {
+    std::size_t n = 0;
+    for (; n != find_batch_group && first != last; ++n, ++first)
+    {
+      keys[n] = first;
+      nodes[n] = m_root;
+    }
+
+    // every leaf is at the same depth, so the group descends in lockstep; by the time
+    // a key's search returns to the level below, the child it picked has been fetched
+    // while the other keys were searched. That is time enough to fetch the probes of
+    // two levels of the child's search, rather than the one a lone descent fetches.
+    for (std::size_t height = m_root->height(); height != 0; --height)
+      for (std::size_t i = 0; i != n; ++i)
+      {
+        branch_node* bp = static_cast<branch_node*>(nodes[i]);
+        nodes[i] = bp->child(m_lower_bound_child(bp, *keys[i]));
+        m_prefetch(nodes[i], height - 1, 2);
+      }
+
+    for (std::size_t i = 0; i != n; ++i, ++result)
+    {
+      leaf_node* lp = static_cast<leaf_node*>(nodes[i]);
+      iterator low = m_adjust_lower_bound(iterator(lp, m_lower_bound(lp, *keys[i])),
+        *keys[i]);
+      *result = (low != end() && !key_comp()(*keys[i], key(*low)))
+        ? low
+        : end();
+    }
+  }
+  return result;
+}
+
+//--------------------------------  cursor::seek()  -----------------------------------//
+
+template <class Key, class Base, class Compare, class Allocator>
+typename mbt_base<Key,Base,Compare,Allocator>::iterator
+mbt_base<Key,Base,Compare,Allocator>::cursor::
+seek(const key_type& k)
+{
+  mbt_base& c = *m_container;
+  leaf_node* lp = m_leaf;
+
+  if (lp->size() == 0
+    || c.key_comp()(k, key(*reinterpret_cast<const value_type*>(lp->begin())))
+    || c.key_comp()(key(*reinterpret_cast<const value_type*>(lp->end()-1)), k))
+  {
+    // climb until k lies within a branch's keys, since a descent from the root to k
+    // must then pass through that branch; the root covers every key
+    std::size_t top = m_path.size() - 1;
+    std::size_t height = top ? 1 : 0;
+    for (; height < top; ++height)
+    {
+      branch_node* bp = m_path[height];
+      if (bp->size() > 1 && !c.key_comp()(k, bp->key(0))
+        && c.key_comp()(k, bp->key(bp->size()-1)))
+        break;
+    }
+
+    node* np = height ? m_path[height] : c.m_root;
+    for (; height != 0; --height)
+    {
+      branch_node* bp = node_cast<branch_node>(np);
+      m_path[height] = bp;
+      np = bp->child(c.m_lower_bound_child(bp, k));
+      c.m_prefetch(np, height - 1);
+    }
+    lp = m_leaf = node_cast<leaf_node>(np);
+  }
+
+  return c.m_adjust_lower_bound(iterator(lp, c.m_lower_bound(lp, k)), k);
+}
+
+//--------------------------------  cursor::reset()  ----------------------------------//
+
+template <class Key, class Base, class Compare, class Allocator>
+void
+mbt_base<Key,Base,Compare,Allocator>::cursor::
+reset()
+{
+  node* np = m_container->m_root;
+  m_path.assign(np->height() + 1, 0);
+  for (std::size_t height = np->height(); height != 0; --height)
+  {
+    m_path[height] = node_cast<branch_node>(np);
+    np = m_path[height]->child(0);
+  }
+  m_leaf = node_cast<leaf_node>(np);
+}
+
 //----------------------------------- count() -----------------------------------------//
 
 template <class Key, class Base, class Compare, class Allocator>
 typename mbt_base<Key,Base,Compare,Allocator>::size_type
 mbt_base<Key,Base,Compare,Allocator>::
 count(const key_type& k) const
+{
+  return m_count(k, counted_branches());
+}
+
+template <class Key, class Base, class Compare, class Allocator>
+typename mbt_base<Key,Base,Compare,Allocator>::size_type
+mbt_base<Key,Base,Compare,Allocator>::
+m_count(const key_type& k, std::false_type) const
 {
   size_type ct = 0;
   for (iterator it = find(k);
@@ -1297,6 +3804,315 @@ count(const key_type& k) const
   return ct;
 }
 
+template <class Key, class Base, class Compare, class Allocator>
+typename mbt_base<Key,Base,Compare,Allocator>::size_type
+mbt_base<Key,Base,Compare,Allocator>::
+m_count(const key_type& k, std::true_type) const
+{
+  leaf_node*  lp;
+  leaf_value* ep;
+  return m_rank(k, true, lp, ep) - m_rank(k, false, lp, ep);
+}
+
+//------------------------------------  rank()  ----------------------------------------//
+
+template <class Key, class Base, class Compare, class Allocator>
+typename mbt_base<Key,Base,Compare,Allocator>::size_type
+mbt_base<Key,Base,Compare,Allocator>::
+rank(const key_type& k) const
+{
+  static_assert(counted_branches::value, "rank() requires order_statistics");
+  leaf_node*  lp;
+  leaf_value* ep;
+  return m_rank(k, false, lp, ep);
+}
+
+template <class Key, class Base, class Compare, class Allocator>
+typename mbt_base<Key,Base,Compare,Allocator>::size_type
+mbt_base<Key,Base,Compare,Allocator>::
+m_rank(const key_type& k, bool upper, leaf_node*& lp, leaf_value*& ep) const
+{
+  // descend as lower_bound() or upper_bound() do, adding up the counts of the children
+  // passed over on the way
+  size_type r = 0;
+  branch_node* bp = node_cast<branch_node>(m_root);
+  while (bp->is_branch())
+  {
+    std::size_t i = upper ? m_upper_bound(bp, k) : m_lower_bound_child(bp, k);
+    m_prefetch(bp->child(i), bp->height() - 1);
+    for (std::size_t j = 0; j != i; ++j)
+      r += bp->count(j);
+    bp = node_cast<branch_node>(bp->child(i));
+  }
+
+  lp = node_cast<leaf_node>(bp);
+  ep = upper ? m_upper_bound(lp, k) : m_lower_bound(lp, k);
+  r += ep - lp->begin();
+
+  // as m_adjust_lower_bound(), for equal elements on the leaves preceding lp
+  while (!upper && ep == lp->begin() && lp->prior_leaf()
+    && !key_comp()(key(*(lp->prior_leaf()->end()-1)), k))
+  {
+    lp = lp->prior_leaf();
+    ep = m_lower_bound(lp, k);
+    r -= lp->end() - ep;
+  }
+  return r;
+}
+
+//-----------------------------------  select()  ---------------------------------------//
+
+template <class Key, class Base, class Compare, class Allocator>
+typename mbt_base<Key,Base,Compare,Allocator>::iterator
+mbt_base<Key,Base,Compare,Allocator>::
+select(size_type i)
+{
+  static_assert(counted_branches::value, "select() requires order_statistics");
+  if (i >= size())
+    return end();
+
+  branch_node* bp = node_cast<branch_node>(m_root);
+  while (bp->is_branch())
+  {
+    std::size_t j = 0;
+    for (; i >= bp->count(j); ++j)
+      i -= bp->count(j);
+    BOOST_ASSERT(j <= bp->size());
+    bp = node_cast<branch_node>(bp->child(j));
+  }
+  leaf_node* lp = node_cast<leaf_node>(bp);
+  return iterator(lp, lp->begin() + i);
+}
+
+//----------------------------------  index_of()  --------------------------------------//
+
+template <class Key, class Base, class Compare, class Allocator>
+typename mbt_base<Key,Base,Compare,Allocator>::size_type
+mbt_base<Key,Base,Compare,Allocator>::
+index_of(const_iterator pos) const
+{
+  static_assert(counted_branches::value, "index_of() requires order_statistics");
+  if (pos == end())
+    return size();
+
+  // rank the first element equivalent to *pos, then count the equivalent elements
+  // from there to pos; in unique containers, there are none
+  leaf_node*  lp;
+  leaf_value* ep;
+  size_type r = m_rank(key(*pos), false, lp, ep);
+  while (lp != pos.m_node)
+  {
+    r += lp->end() - ep;
+    lp = lp->next_leaf();
+    ep = lp->begin();
+  }
+  return r + (pos.m_element - ep);
+}
+
+//------------------------------  order statistic counts  ------------------------------//
+
+template <class Key, class Base, class Compare, class Allocator>
+void
+mbt_base<Key,Base,Compare,Allocator>::
+m_add_count(leaf_node* lp, difference_type n, std::true_type)
+{
+  if (aggregated_branches::value)
+  {
+    // a monoid need not have inverses, so the summaries are recomputed instead
+    if (lp == m_last_leaf)
+      m_recount_right_edge(m_root);
+    else
+      m_recount_ancestors(lp);
+    return;
+  }
+
+  if (lp == m_last_leaf)
+  {
+    // the path to the last leaf is the right edge, so needs no child->parent list
+    for (node* np = m_root; np->is_branch();)
+    {
+      branch_node* bp = node_cast<branch_node>(np);
+      bp->count(bp->size()) += n;
+      np = bp->child(bp->size());
+    }
+    return;
+  }
+
+  for (node* np = lp; !np->is_root(); np = np->parent_node())
+    np->parent_node()->count(np->parent_index()) += n;
+}
+
+template <class Key, class Base, class Compare, class Allocator>
+void
+mbt_base<Key,Base,Compare,Allocator>::
+m_count_append(const value_type& x, std::true_type)
+{
+  for (node* np = m_root; np->is_branch();)
+  {
+    branch_node* bp = node_cast<branch_node>(np);
+    ++bp->count(bp->size());
+    m_combine_aggregate(bp, bp->size(), x, aggregated_branches());
+    np = bp->child(bp->size());
+  }
+}
+
+template <class Key, class Base, class Compare, class Allocator>
+void
+mbt_base<Key,Base,Compare,Allocator>::
+m_recount_ancestors(node* np, bool siblings, std::true_type)
+{
+  for (; !np->is_root(); np = np->parent_node())
+  {
+    branch_node* bp = np->parent_node();
+    std::size_t i = np->parent_index();
+    m_recount_child(bp, i);
+    if (siblings && i != 0)
+      m_recount_child(bp, i - 1);
+    if (siblings && i != bp->size())
+      m_recount_child(bp, i + 1);
+  }
+}
+
+template <class Key, class Base, class Compare, class Allocator>
+typename mbt_base<Key,Base,Compare,Allocator>::size_type
+mbt_base<Key,Base,Compare,Allocator>::
+m_recount_subtree(node* np)
+{
+  if (np->is_leaf())
+    return np->size();
+
+  branch_node* bp = node_cast<branch_node>(np);
+  size_type n = 0;
+  for (std::size_t i = 0; i <= bp->size(); ++i)
+  {
+    n += bp->count(i) = m_recount_subtree(bp->child(i));
+    m_reaggregate_child(bp, i, aggregated_branches());
+  }
+  return n;
+}
+
+template <class Key, class Base, class Compare, class Allocator>
+void
+mbt_base<Key,Base,Compare,Allocator>::
+m_recount_right_edge(node* np)
+{
+  if (np->is_leaf())
+    return;
+  branch_node* bp = node_cast<branch_node>(np);
+  m_recount_right_edge(bp->child(bp->size()));
+  m_recount_child(bp, bp->size());
+}
+
+template <class Key, class Base, class Compare, class Allocator>
+typename mbt_base<Key,Base,Compare,Allocator>::size_type
+mbt_base<Key,Base,Compare,Allocator>::
+m_subtree_size(node* np)
+{
+  if (np->is_leaf())
+    return np->size();
+
+  branch_node* bp = node_cast<branch_node>(np);
+  size_type n = 0;
+  for (std::size_t i = 0; i <= bp->size(); ++i)
+    n += bp->count(i);
+  return n;
+}
+
+template <class Key, class Base, class Compare, class Allocator>
+typename mbt_base<Key,Base,Compare,Allocator>::aggregate_type
+mbt_base<Key,Base,Compare,Allocator>::
+m_subtree_aggregate(node* np)
+{
+  monoid_type m;
+  aggregate_type a = m.identity();
+  if (np->is_leaf())
+  {
+    leaf_node* lp = node_cast<leaf_node>(np);
+    for (leaf_value* it = lp->begin(); it != lp->end(); ++it)
+      a = m.combine(a, m.element(*reinterpret_cast<const value_type*>(it)));
+    return a;
+  }
+
+  branch_node* bp = node_cast<branch_node>(np);
+  for (std::size_t i = 0; i <= bp->size(); ++i)
+    a = m.combine(a, bp->aggregate(i));
+  return a;
+}
+
+template <class Key, class Base, class Compare, class Allocator>
+typename mbt_base<Key,Base,Compare,Allocator>::aggregate_type
+mbt_base<Key,Base,Compare,Allocator>::
+m_aggregate(node* np, size_type first, size_type last)
+{
+  monoid_type m;
+  aggregate_type a = m.identity();
+  if (np->is_leaf())
+  {
+    leaf_node* lp = node_cast<leaf_node>(np);
+    for (leaf_value* it = lp->begin() + first; it != lp->begin() + last; ++it)
+      a = m.combine(a, m.element(*reinterpret_cast<const value_type*>(it)));
+    return a;
+  }
+
+  // children wholly within [first, last) contribute their summaries; only those
+  // holding an end of the range are descended into
+  branch_node* bp = node_cast<branch_node>(np);
+  size_type lo = 0;
+  for (std::size_t i = 0; i <= bp->size() && lo < last; ++i)
+  {
+    size_type hi = lo + bp->count(i);
+    if (first <= lo && hi <= last)
+      a = m.combine(a, bp->aggregate(i));
+    else if (first < hi)
+      a = m.combine(a, m_aggregate(bp->child(i), first < lo ? 0 : first - lo,
+        (last < hi ? last : hi) - lo));
+    lo = hi;
+  }
+  return a;
+}
+
+//-------------------------------  range_aggregate()  ----------------------------------//
+
+template <class Key, class Base, class Compare, class Allocator>
+typename mbt_base<Key,Base,Compare,Allocator>::aggregate_type
+mbt_base<Key,Base,Compare,Allocator>::
+range_aggregate(const key_type& lo, const key_type& hi) const
+{
+  static_assert(aggregated_branches::value,
+    "range_aggregate() requires aggregate_statistics");
+  if (!key_comp()(lo, hi))
+    return monoid_type().identity();
+
+  leaf_node*  lp;
+  leaf_value* ep;
+  size_type first = m_rank(lo, false, lp, ep);
+  return m_aggregate(m_root, first, m_rank(hi, false, lp, ep));
+}
+
+template <class Key, class Base, class Compare, class Allocator>
+typename mbt_base<Key,Base,Compare,Allocator>::aggregate_type
+mbt_base<Key,Base,Compare,Allocator>::
+range_aggregate(const_iterator first, const_iterator last) const
+{
+  static_assert(aggregated_branches::value,
+    "range_aggregate() requires aggregate_statistics");
+  return m_aggregate(m_root, index_of(first), index_of(last));
+}
+
+//------------------------------  update_aggregates()  ---------------------------------//
+
+template <class Key, class Base, class Compare, class Allocator>
+void
+mbt_base<Key,Base,Compare,Allocator>::
+update_aggregates(const_iterator pos)
+{
+  static_assert(aggregated_branches::value,
+    "update_aggregates() requires aggregate_statistics");
+  BOOST_ASSERT_MSG(pos != end(), "update_aggregates() on end iterator");
+  m_build_parent_list(pos.m_node);  // lookups and iteration don't create it
+  m_recount_ancestors(pos.m_node);
+}
+
 //----------------------------------- dump_dot -----------------------------------------//
 
 template <class Key, class Base, class Compare, class Allocator>
@@ -1320,23 +4136,15 @@ m_dump_node(std::ostream& os, node* np) const
   {
     os << "node_" << np << "[label = \"";
     branch_node* bp = node_cast<branch_node>(np);
-    int f = 0;
-    branch_value* it;
-    for (it = bp->begin(); it != bp->end(); ++it)
-    {
-      os << "<f" << f << ">|" << it->second << "|";
-      ++f;
-    }
+    std::size_t f = 0;
+    for (; f != bp->size(); ++f)
+      os << "<f" << f << ">|" << bp->key(f) << "|";
     os << "<f" << f << ">\",fillcolor=\"lightblue\"];\n";
-    f = 0;
-    for (it = bp->begin(); it != bp->end(); ++it)
+    for (f = 0; f <= bp->size(); ++f)
     {
-      os << "\"node_" << bp << "\":f" << f << " -> \"node_" << it->first << "\":f0;\n";
-      m_dump_node(os, it->first);
-      ++f;
+      os << "\"node_" << bp << "\":f" << f << " -> \"node_" << bp->child(f) << "\":f0;\n";
+      m_dump_node(os, bp->child(f));
     }
-    os << "\"node_" << bp << "\":f" << f << " -> \"node_" << it->first << "\":f0;\n";
-    m_dump_node(os, it->first);
   }
 }
 
@@ -1365,21 +4173,21 @@ next_node(Node*)  // return next node at same height, root_node if end
     return node_cast<Node>(this);
 
   branch_node*   parent_np = this->parent_node();
-  branch_value*  parent_ep = this->parent_element();
+  std::size_t    parent_i = this->parent_index();
 
-  if (parent_ep != parent_np->end())
-    ++parent_ep;
+  if (parent_i != parent_np->size())
+    ++parent_i;
   else
   {
     parent_np = this->parent_node()->next_node(parent_np);
     if (parent_np->is_root())
       return node_cast<Node>(parent_np);
-    parent_ep = parent_np->begin();
+    parent_i = 0;
   }
 
-  Node* np = node_cast<Node>(parent_ep->first);
+  Node* np = node_cast<Node>(parent_np->child(parent_i));
   np->parent_node(parent_np);
-  np->parent_element(parent_ep);
+  np->parent_index(parent_i);
   return np;
 }
 
@@ -1400,12 +4208,12 @@ increment()
   if (++m_element != m_node->end())
     return;
 
-  m_node = m_node->next_node(m_node);  // next leaf node, or root node if end
-
-  if (!m_node->is_root())
+  if (m_node->next_leaf())
   {
+    m_node = m_node->next_leaf();
     m_element = m_node->begin();
     BOOST_ASSERT(m_element != m_node->end());
+    BOOST_BTREE_PREFETCH(m_node->next_leaf());  // a scan will likely reach it
   }
   else // end() reached
   {
@@ -1414,36 +4222,6 @@ increment()
   }
 }
 
-//-------------------------------  node::prior_node()  ---------------------------------//
-
-template <class Key, class Base, class Compare, class Allocator>
-template <class Node>
-Node*
-mbt_base<Key,Base,Compare,Allocator>::node::
-prior_node(Node*)  // return prior node at same height, root_node if end
-{
-  if (this->is_root())
-    return node_cast<Node>(this);
-
-  branch_node*   parent_np = this->parent_node();
-  branch_value*  parent_ep = this->parent_element();
-
-  if (parent_ep != parent_np->begin())
-    --parent_ep;
-  else
-  {
-    parent_np = this->parent_node()->prior_node(parent_np);
-    if (parent_np->is_root())
-      return node_cast<Node>(parent_np);
-    parent_ep = parent_np->end();
-  }
-
-  Node* np = node_cast<Node>(parent_ep->first);
-  np->parent_node(parent_np);
-  np->parent_element(parent_ep);
-  return np;
-}
-
 //--------------------------  iterator::decrement()  -----------------------------------//
 
 template <class Key, class Base, class Compare, class Allocator>
@@ -1460,11 +4238,11 @@ decrement()
     --m_element;
   else  // not on this node
   {
-    m_node = m_node->prior_node(m_node);
+    m_node = m_node->prior_leaf();
 
-    if (m_node->is_root())  // precondition violation, so all bets are off
+    if (!m_node)  // precondition violation, so all bets are off
     {
-      BOOST_ASSERT_MSG(!m_node->is_root(), "attempt to decrement begin() iterator");
+      BOOST_ASSERT_MSG(m_node, "attempt to decrement begin() iterator");
       throw std::runtime_error("attempt to decrement begin() iterator");
     }
     else
@@ -1472,6 +4250,7 @@ decrement()
       m_element = m_node->end();
       BOOST_ASSERT(m_element != m_node->begin());
       --m_element;
+      BOOST_BTREE_PREFETCH(m_node->prior_leaf());  // a scan will likely reach it
     }
   }
 }
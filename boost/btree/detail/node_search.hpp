@@ -0,0 +1,145 @@
+//  node_search.hpp  -------------------------------------------------------------------//
+
+//  Copyright Beman Dawes 2011
+
+//  Distributed under the Boost Software License, Version 1.0.
+//  See http://www.boost.org/LICENSE_1_0.txt
+
+//  This code is experimental and has not been accepted as a boost.org library
+
+//  In-node search for any key type, used by the search policies of mbt_base. See
+//  simd_search.hpp for the kernels used instead for integral keys.
+//
+//  branchless_bound() is a binary search whose loop has no data dependent branch, so
+//  there is no misprediction to pay for on each probe. Eytzinger order lays the keys of
+//  a node out as an implicit binary tree in breadth first order, so the probes of a
+//  search walk forward through memory and the keys several probes ahead are adjacent,
+//  letting them be prefetched a cache line at a time.
+
+#ifndef BOOST_BTREE_NODE_SEARCH_HPP
+#define BOOST_BTREE_NODE_SEARCH_HPP
+
+#include <cstddef>
+#include <boost/cstdint.hpp>
+#include <boost/btree/detail/prefetch.hpp>
+
+namespace boost
+{
+namespace detail
+{
+
+//---------------------------------- branchless_bound() --------------------------------//
+
+template <class T, class K, class Compare>
+T* branchless_bound(T* first, std::size_t n, const K& k, bool upper, Compare comp)
+
+// Requires: [first, first+n) is ordered by comp.
+//
+// Returns: std::lower_bound(first, first+n, k, comp), or std::upper_bound if upper.
+
+{
+  if (n == 0)
+    return first;
+
+  // an element precedes the bound if it is less than k (lower_bound) or not greater
+  // than k (upper_bound)
+  while (n > 1)
+  {
+    std::size_t half = n / 2;
+
+    // the next probe is in one of two places; fetch both rather than wait on the miss
+    std::size_t next = (n - half) / 2;
+    BOOST_BTREE_PREFETCH(first + next);
+    BOOST_BTREE_PREFETCH(first + half + next);
+
+    bool precedes = upper ? !comp(k, first[half]) : comp(first[half], k);
+    first = precedes ? first + half : first;  // usually compiled without a branch
+    n -= half;
+  }
+  return first + (upper ? !comp(k, *first) : comp(*first, k));
+}
+
+//----------------------------------- Eytzinger order ----------------------------------//
+
+//  The arrays are one-based: element 1 is the root of the implicit tree, and the
+//  children of element i are 2i and 2i+1. ranks[i] is the index in sorted order of
+//  keys[i].
+
+template <class K>
+std::size_t eytzinger_fill(const K* sorted, std::size_t n, K* keys,
+  boost::uint16_t* ranks, std::size_t i = 1, std::size_t next = 0)
+
+// Requires: keys and ranks have room for n + 1 elements. K is trivially copyable.
+//
+// Effects: Copies the n elements of sorted into keys in Eytzinger order, recording
+//          their sorted positions in ranks.
+//
+// Returns: next plus the number of elements in the subtree rooted at i; so n when
+//          called with the default arguments.
+
+{
+  if (i <= n)
+  {
+    next = eytzinger_fill(sorted, n, keys, ranks, 2 * i, next);
+    keys[i] = sorted[next];
+    ranks[i] = static_cast<boost::uint16_t>(next++);
+    next = eytzinger_fill(sorted, n, keys, ranks, 2 * i + 1, next);
+  }
+  return next;
+}
+
+//  Elements this far below element i in the implicit tree, ahead * i and on, fill at
+//  most a cache line, so a single prefetch covers several probes in advance.
+
+template <class K>
+struct eytzinger_ahead
+{
+  static const std::size_t bytes = 64;
+  static const std::size_t value = sizeof(K) * 16 <= bytes ? 16
+    : sizeof(K) * 8 <= bytes ? 8 : sizeof(K) * 4 <= bytes ? 4 : 2;
+};
+
+inline std::size_t eytzinger_unwind(std::size_t i)
+// Returns: i with its trailing one bits, and the zero bit above them, shifted away.
+{
+#if defined(__GNUC__) || defined(__clang__)
+  return i >> (__builtin_ctzll(~static_cast<unsigned long long>(i)) + 1);
+#else
+  while (i & 1)
+    i >>= 1;
+  return i >> 1;
+#endif
+}
+
+template <class K, class Compare>
+std::size_t eytzinger_bound(const K* keys, const boost::uint16_t* ranks, std::size_t n,
+  const K& k, bool upper, Compare comp)
+
+// Requires: keys and ranks were filled by eytzinger_fill() from n elements ordered by
+//           comp.
+//
+// Returns: The index std::lower_bound would return for k over the sorted elements, or
+//          std::upper_bound if upper.
+
+{
+  std::size_t i = 1;
+  while (i <= n)
+  {
+    // the address may be past the end of keys, which a prefetch tolerates
+    BOOST_BTREE_PREFETCH(reinterpret_cast<const char*>(keys)
+      + eytzinger_ahead<K>::value * i * sizeof(K));
+    bool precedes = upper ? !comp(k, keys[i]) : comp(keys[i], k);
+    i = 2 * i + precedes;
+  }
+
+  // the trailing ones of i are the right turns taken after the last left turn, and
+  // the element where that left turn was taken is the bound; 0 if there was none
+  i = eytzinger_unwind(i);
+  return i ? ranks[i] : n;
+}
+
+} // namespace detail
+
+} // namespace boost
+
+#endif  // BOOST_BTREE_NODE_SEARCH_HPP
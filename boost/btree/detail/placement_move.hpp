@@ -11,7 +11,11 @@
 #define BOOST_DETAIL_PLACEMENT_MOVE_HPP
 
 #include <cstddef>
+#include <cstring>      // for memmove
 #include <iterator>
+#include <algorithm>    // for move, move_backward
+#include <utility>      // for pair
+#include <type_traits>
 #include <boost/assert.hpp>
 
 namespace boost
@@ -19,6 +23,22 @@ namespace boost
 namespace detail
 {
 
+//------------------------------------ is_memmovable -----------------------------------//
+
+//  True if moving a T, whether by move construction followed by destruction of the
+//  source or by move assignment, is equivalent to copying its bytes. std::pair is not
+//  trivially copyable, because of its assignment operators, but moving a pair of such
+//  types is still a copy of its bytes.
+
+template <class T>
+struct is_memmovable
+  : std::integral_constant<bool, std::is_trivially_copyable<T>::value> {};
+
+template <class T1, class T2>
+struct is_memmovable<std::pair<T1, T2> >
+  : std::integral_constant<bool,
+      is_memmovable<T1>::value && is_memmovable<T2>::value> {};
+
 //------------------------------------ placement_move() --------------------------------//
 
 template<class InputIterator, class OutputIterator>
@@ -48,32 +68,126 @@ placement_move(InputIterator first, InputIterator last, OutputIterator result)
   }
   return result;
 }
+
+//---------------------------- placement_move_backward() -------------------------------//
+
+template<class BidirectionalIterator>
+BidirectionalIterator
+placement_move_backward(BidirectionalIterator first, BidirectionalIterator last,
+  BidirectionalIterator result)
+
+// Requires: result shall not be in the range (first,last].
+//
+// Effects: Moves elements in the range [first,last) into the range [result-(last-first),
+// result) starting from last - 1 and proceeding to first. For each positive integer
+// n <= (last - first), performs:
 //
-////------------------------------- placement_move_backward() ----------------------------//
+//    typedef typename std::iterator_traits<BidirectionalIterator>::value_type value_type;
+//    ::new (result-n) value_type(std::move(*(last-n)));
+//    (last-n)->~value_type();
 //
-//template<class RandomIterator>
-//void
-//placement_move(RandomIterator first, RandomIterator last, RandomIterator result)
+// Remarks: The destination may overlap the end of the source, so elements can be
+// shifted toward uninitialized memory following them.
 //
-//// Requires: result shall not be in the range [first,last).
-////
-//// Effects: Moves elements in the range [first,last) into the range [result-(last-first),
-//// result) starting from last - 1 and proceeding to first.273 For each positive integer
-//// n <= (last - first), performs:
-////
-////    typedef typename std::iterator_traits<RandomIterator>::value_type value_type;
-////    ::new (result-n) value_type(std::move(*(last-n)));
-////
-//// Complexity: Exactly last - first move assignments.
+// Returns: result - (last - first).
 //
-//{
-//  typedef typename std::iterator_traits<RandomIterator>::value_type value_type;
-//  for (; first != last; ++first, ++result)
-//  {
-//...    ::new (result) value_type(std::move(*first));
-//...    first->~value_type();
-//  }
-//}
+// Complexity: Exactly last - first placement move constructions.
+
+{
+  typedef typename std::iterator_traits<BidirectionalIterator>::value_type value_type;
+  while (first != last)
+  {
+    ::new (--result) value_type(std::move(*--last));
+    last->~value_type();
+  }
+  return result;
+}
+
+//---------------------------  pointer range implementations  --------------------------//
+
+//  For pointers to memmovable types, each of the functions below moves the whole
+//  range with a single memmove. The ranges may overlap as each function's Requires
+//  clause allows.
+
+template <class T>
+inline T* memmove_range(T* first, T* last, T* result)
+{
+  std::memmove(static_cast<void*>(result), static_cast<const void*>(first),
+    (last - first) * sizeof(T));
+  return result + (last - first);
+}
+
+template <class T>
+inline T* placement_move_impl(T* first, T* last, T* result, std::true_type)
+  {return memmove_range(first, last, result);}
+
+template <class T>
+inline T* placement_move_impl(T* first, T* last, T* result, std::false_type)
+{
+  for (; first != last; ++first, ++result)
+  {
+    ::new (result) T(std::move(*first));
+    first->~T();
+  }
+  return result;
+}
+
+template <class T>
+inline T* placement_move(T* first, T* last, T* result)
+  {return placement_move_impl(first, last, result, is_memmovable<T>());}
+
+template <class T>
+inline T* placement_move_backward_impl(T* first, T* last, T* result, std::true_type)
+  {return memmove_range(first, last, result - (last - first));}
+
+template <class T>
+inline T* placement_move_backward_impl(T* first, T* last, T* result, std::false_type)
+{
+  while (first != last)
+  {
+    ::new (--result) T(std::move(*--last));
+    last->~T();
+  }
+  return result;
+}
+
+template <class T>
+inline T* placement_move_backward(T* first, T* last, T* result)
+  {return placement_move_backward_impl(first, last, result, is_memmovable<T>());}
+
+//------------------------------  move_range()  ----------------------------------------//
+
+//  Effects: As if by std::move(first, last, result), which the ranges may overlap as
+//  it allows, but a single memmove if T is memmovable.
+
+template <class T>
+inline T* move_range_impl(T* first, T* last, T* result, std::true_type)
+  {return memmove_range(first, last, result);}
+
+template <class T>
+inline T* move_range_impl(T* first, T* last, T* result, std::false_type)
+  {return std::move(first, last, result);}
+
+template <class T>
+inline T* move_range(T* first, T* last, T* result)
+  {return move_range_impl(first, last, result, is_memmovable<T>());}
+
+//---------------------------  move_range_backward()  ----------------------------------//
+
+//  Effects: As if by std::move_backward(first, last, result), which the ranges may
+//  overlap as it allows, but a single memmove if T is memmovable.
+
+template <class T>
+inline T* move_range_backward_impl(T* first, T* last, T* result, std::true_type)
+  {return memmove_range(first, last, result - (last - first));}
+
+template <class T>
+inline T* move_range_backward_impl(T* first, T* last, T* result, std::false_type)
+  {return std::move_backward(first, last, result);}
+
+template <class T>
+inline T* move_range_backward(T* first, T* last, T* result)
+  {return move_range_backward_impl(first, last, result, is_memmovable<T>());}
 
 } // namespace detail
 
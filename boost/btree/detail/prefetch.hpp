@@ -0,0 +1,32 @@
+//  prefetch.hpp  ----------------------------------------------------------------------//
+
+//  Copyright Beman Dawes 2011
+
+//  Distributed under the Boost Software License, Version 1.0.
+//  See http://www.boost.org/LICENSE_1_0.txt
+
+//  This code is experimental and has not been accepted as a boost.org library
+
+//  BOOST_BTREE_PREFETCH(p) hints that the cache line holding address p will soon be
+//  read. It never faults, so p may be past the end of an array, and it expands to
+//  nothing on compilers without a prefetch intrinsic.
+//
+//  The in-node searches and the tree descents and scans use it. Define
+//  BOOST_BTREE_NO_PREFETCH to compile all of them without software prefetches.
+
+#ifndef BOOST_BTREE_PREFETCH_HPP
+#define BOOST_BTREE_PREFETCH_HPP
+
+#if defined(BOOST_BTREE_NO_PREFETCH)
+# define BOOST_BTREE_PREFETCH(p) static_cast<void>(0)
+#elif defined(__GNUC__) || defined(__clang__)
+# define BOOST_BTREE_PREFETCH(p) __builtin_prefetch(p)
+#elif defined(_MSC_VER) && (defined(_M_X64) || defined(_M_IX86))
+# include <xmmintrin.h>
+# define BOOST_BTREE_PREFETCH(p) \
+    _mm_prefetch(reinterpret_cast<const char*>(p), _MM_HINT_T0)
+#else
+# define BOOST_BTREE_PREFETCH(p) static_cast<void>(0)
+#endif
+
+#endif  // BOOST_BTREE_PREFETCH_HPP
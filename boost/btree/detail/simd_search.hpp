@@ -0,0 +1,294 @@
+//  simd_search.hpp  -------------------------------------------------------------------//
+
+//  Copyright Beman Dawes 2011
+
+//  Distributed under the Boost Software License, Version 1.0.
+//  See http://www.boost.org/LICENSE_1_0.txt
+
+//  This code is experimental and has not been accepted as a boost.org library
+
+//  In-node search for integral keys ordered by std::less or std::greater. A branchless
+//  binary search narrows the node to a window of a few keys, then a vector compare of
+//  the key against the whole window counts the keys that precede it. The
+//  AVX2 or SSE4.2 kernel is chosen at runtime; without either, callers fall back to
+//  std::lower_bound and std::upper_bound.
+//
+//  Keys need not be contiguous; they are stride bytes apart, so the kernels work
+//  directly on the key arrays of branches as well as on a map's leaf_value pairs. AVX2
+//  gathers them; SSE4.2 loads them one at a time.
+//
+//  Defines BOOST_BTREE_SIMD_SEARCH for x86 and x64 with GCC, Clang, or VC++, unless
+//  BOOST_BTREE_NO_SIMD_SEARCH is defined.
+
+#ifndef BOOST_BTREE_SIMD_SEARCH_HPP
+#define BOOST_BTREE_SIMD_SEARCH_HPP
+
+#include <cstddef>
+#include <cstring>
+#include <functional>
+#include <type_traits>
+#include <boost/cstdint.hpp>
+#include <boost/btree/detail/prefetch.hpp>
+
+#if !defined(BOOST_BTREE_NO_SIMD_SEARCH) \
+  && (defined(__x86_64__) || defined(__i386__) || defined(_M_X64) || defined(_M_IX86)) \
+  && (defined(__GNUC__) || defined(__clang__) || defined(_MSC_VER))
+# define BOOST_BTREE_SIMD_SEARCH
+# include <immintrin.h>
+# ifdef _MSC_VER
+#   include <intrin.h>
+#   define BOOST_BTREE_TARGET(features)
+# else
+#   define BOOST_BTREE_TARGET(features) __attribute__((target(features)))
+# endif
+#endif
+
+namespace boost
+{
+namespace detail
+{
+
+//--------------------------------- is_simd_searchable ---------------------------------//
+
+//  True if the kernels below can search Key ordered by Compare
+
+template <class Key, class Compare>
+struct is_simd_searchable
+  : std::integral_constant<bool,
+#ifdef BOOST_BTREE_SIMD_SEARCH
+      std::is_integral<Key>::value && !std::is_same<Key, bool>::value
+      && (sizeof(Key) == 1 || sizeof(Key) == 2 || sizeof(Key) == 4 || sizeof(Key) == 8)
+      && (std::is_same<Compare, std::less<Key> >::value
+        || std::is_same<Compare, std::greater<Key> >::value)
+#else
+      false
+#endif
+    > {};
+
+//------------------------------------ simd_support() ----------------------------------//
+
+enum simd_level { simd_none, simd_sse42, simd_avx2 };
+
+#ifdef BOOST_BTREE_SIMD_SEARCH
+
+inline simd_level simd_detect()
+{
+#ifdef _MSC_VER
+  int info[4];
+  __cpuid(info, 0);
+  if (info[0] < 1)
+    return simd_none;
+  __cpuid(info, 1);
+  bool sse42 = (info[2] & (1 << 20)) && (info[2] & (1 << 23));  // and popcnt
+  bool os_ymm = (info[2] & (1 << 27)) && (info[2] & (1 << 28))  // osxsave, avx
+    && (_xgetbv(0) & 6) == 6;
+  bool avx2 = false;
+  __cpuid(info, 0);
+  if (info[0] >= 7 && os_ymm)
+  {
+    __cpuidex(info, 7, 0);
+    avx2 = (info[1] & (1 << 5)) != 0;
+  }
+#else
+  __builtin_cpu_init();
+  bool sse42 = __builtin_cpu_supports("sse4.2") && __builtin_cpu_supports("popcnt");
+  bool avx2 = __builtin_cpu_supports("avx2");
+#endif
+  return sse42 && avx2 ? simd_avx2 : sse42 ? simd_sse42 : simd_none;
+}
+
+#endif
+
+inline simd_level simd_support()
+// Returns: The best kernel the CPU supports, or simd_none if BOOST_BTREE_SIMD_SEARCH
+//          is not defined.
+{
+#ifdef BOOST_BTREE_SIMD_SEARCH
+  static const simd_level level = simd_detect();
+  return level;
+#else
+  return simd_none;
+#endif
+}
+
+#ifdef BOOST_BTREE_SIMD_SEARCH
+
+//--------------------------------------- kernels --------------------------------------//
+
+//  Each kernel returns the number of the len keys at base, base + stride, ... whose
+//  lane values v satisfy k > v, or v > k if !k_greater. The lane value of a key is the
+//  key itself for signed 64-bit keys, the key with its top bit flipped for unsigned
+//  64-bit keys, and likewise for 32-bit lanes, into which 8- and 16-bit keys are
+//  widened. So signed vector compares order lane values as Key is ordered.
+
+template <class Key>
+inline boost::int64_t simd_lane64(Key k)
+{
+  return std::is_signed<Key>::value ? boost::int64_t(k)
+    : boost::int64_t(boost::uint64_t(k) ^ (boost::uint64_t(1) << 63));
+}
+
+template <class Key>
+inline boost::int32_t simd_lane32(Key k)
+{
+  return sizeof(Key) < 4 || std::is_signed<Key>::value ? boost::int32_t(k)
+    : boost::int32_t(boost::uint32_t(k) ^ 0x80000000u);
+}
+
+template <class Key>
+inline Key simd_load(const char* p)
+{
+  Key k;
+  std::memcpy(&k, p, sizeof(Key));
+  return k;
+}
+
+template <class Key>
+BOOST_BTREE_TARGET("avx2,popcnt")
+std::size_t simd_count_avx2(const char* base, std::size_t len, std::size_t stride,
+  Key key, bool k_greater)
+{
+  std::size_t count = 0;
+  if (sizeof(Key) == 8)
+  {
+    const __m256i k = _mm256_set1_epi64x(simd_lane64(key));
+    const __m256i flip = _mm256_set1_epi64x(
+      std::is_signed<Key>::value ? 0 : boost::int64_t(boost::uint64_t(1) << 63));
+    const __m128i offsets
+      = _mm_mullo_epi32(_mm_setr_epi32(0, 1, 2, 3), _mm_set1_epi32(int(stride)));
+    const __m256i lanes = _mm256_setr_epi64x(0, 1, 2, 3);
+    for (std::size_t i = 0; i < len; i += 4, base += 4 * stride)
+    {
+      __m256i mask = _mm256_cmpgt_epi64(
+        _mm256_set1_epi64x(boost::int64_t(len - i)), lanes);
+      __m256i v = _mm256_mask_i32gather_epi64(_mm256_setzero_si256(),
+        reinterpret_cast<const long long*>(base), offsets, mask, 1);
+      v = _mm256_xor_si256(v, flip);
+      __m256i hit = k_greater ? _mm256_cmpgt_epi64(k, v) : _mm256_cmpgt_epi64(v, k);
+      count += _mm_popcnt_u32(
+        _mm256_movemask_pd(_mm256_castsi256_pd(_mm256_and_si256(hit, mask))));
+    }
+  }
+  else
+  {
+    // a narrow key is gathered as the high order bytes of a 32-bit lane, then shifted
+    // down; the bytes below it belong to the same node, so are safe to read
+    const int shift = int(8 * (4 - sizeof(Key)));
+    const __m256i k = _mm256_set1_epi32(simd_lane32(key));
+    const __m256i flip = _mm256_set1_epi32(
+      sizeof(Key) == 4 && !std::is_signed<Key>::value ? int(0x80000000u) : 0);
+    const __m256i offsets = _mm256_mullo_epi32(
+      _mm256_setr_epi32(0, 1, 2, 3, 4, 5, 6, 7), _mm256_set1_epi32(int(stride)));
+    const __m256i lanes = _mm256_setr_epi32(0, 1, 2, 3, 4, 5, 6, 7);
+    base -= 4 - sizeof(Key);
+    for (std::size_t i = 0; i < len; i += 8, base += 8 * stride)
+    {
+      __m256i mask = _mm256_cmpgt_epi32(_mm256_set1_epi32(int(len - i)), lanes);
+      __m256i v = _mm256_mask_i32gather_epi32(_mm256_setzero_si256(),
+        reinterpret_cast<const int*>(base), offsets, mask, 1);
+      if (shift)
+        v = std::is_signed<Key>::value ? _mm256_srai_epi32(v, shift)
+          : _mm256_srli_epi32(v, shift);
+      v = _mm256_xor_si256(v, flip);
+      __m256i hit = k_greater ? _mm256_cmpgt_epi32(k, v) : _mm256_cmpgt_epi32(v, k);
+      count += _mm_popcnt_u32(
+        _mm256_movemask_ps(_mm256_castsi256_ps(_mm256_and_si256(hit, mask))));
+    }
+  }
+  return count;
+}
+
+template <class Key>
+BOOST_BTREE_TARGET("sse4.2,popcnt")
+std::size_t simd_count_sse42(const char* base, std::size_t len, std::size_t stride,
+  Key key, bool k_greater)
+{
+  // without a gather, lanes are loaded one at a time; lanes past len are filled with
+  // the key itself, which compares as neither less nor greater
+  std::size_t count = 0;
+  if (sizeof(Key) == 8)
+  {
+    const __m128i k = _mm_set1_epi64x(simd_lane64(key));
+    for (std::size_t i = 0; i < len; i += 2, base += 2 * stride)
+    {
+      __m128i v = _mm_set_epi64x(
+        i + 1 < len ? simd_lane64(simd_load<Key>(base + stride)) : simd_lane64(key),
+        simd_lane64(simd_load<Key>(base)));
+      __m128i hit = k_greater ? _mm_cmpgt_epi64(k, v) : _mm_cmpgt_epi64(v, k);
+      count += _mm_popcnt_u32(_mm_movemask_pd(_mm_castsi128_pd(hit)));
+    }
+  }
+  else
+  {
+    const __m128i k = _mm_set1_epi32(simd_lane32(key));
+    const boost::int32_t pad = simd_lane32(key);
+    for (std::size_t i = 0; i < len; i += 4, base += 4 * stride)
+    {
+      __m128i v = _mm_setr_epi32(
+        simd_lane32(simd_load<Key>(base)),
+        i + 1 < len ? simd_lane32(simd_load<Key>(base + stride)) : pad,
+        i + 2 < len ? simd_lane32(simd_load<Key>(base + 2 * stride)) : pad,
+        i + 3 < len ? simd_lane32(simd_load<Key>(base + 3 * stride)) : pad);
+      __m128i hit = k_greater ? _mm_cmpgt_epi32(k, v) : _mm_cmpgt_epi32(v, k);
+      count += _mm_popcnt_u32(_mm_movemask_ps(_mm_castsi128_ps(hit)));
+    }
+  }
+  return count;
+}
+
+//------------------------------------- simd_bound() -----------------------------------//
+
+//  The binary search stops at a window of this many keys. Wider windows cost more
+//  cache lines than the probes they replace.
+
+const std::size_t simd_window = 8;
+
+template <class Key, class Compare>
+std::size_t simd_bound(const char* first, std::size_t n, std::size_t stride,
+  Key k, bool upper, simd_level level)
+
+// Requires: is_simd_searchable<Key, Compare>::value, level != simd_none and is supported
+//           by the CPU. first points to the first of n keys, each stride bytes after
+//           the prior one, ordered by Compare.
+//
+// Returns: The index std::lower_bound would return for k, or std::upper_bound if upper.
+
+{
+  const bool less = std::is_same<Compare, std::less<Key> >::value;
+
+  // a key precedes the bound if it is less than k (lower_bound) or not greater than
+  // k (upper_bound), in Compare's order
+  std::size_t base = 0;
+  while (n > simd_window)
+  {
+    std::size_t half = n / 2;
+
+    // without a branch to speculate past, each probe would wait on the cache miss of
+    // the one before, so fetch both of the candidates for the next probe now
+    std::size_t next = (n - half) / 2;
+    BOOST_BTREE_PREFETCH(first + (base + next) * stride);
+    BOOST_BTREE_PREFETCH(first + (base + half + next) * stride);
+
+    Key v = simd_load<Key>(first + (base + half) * stride);
+    bool precedes = upper ? !(less ? k < v : v < k) : (less ? v < k : k < v);
+    base = precedes ? base + half : base;  // usually compiled without a branch
+    n -= half;
+  }
+
+  // count the keys preceding the bound in the window [base, base+n); for upper_bound,
+  // that is n less the keys following k
+  bool k_greater = upper ? !less : less;
+  const char* window = first + base * stride;
+  std::size_t count = level == simd_avx2
+    ? simd_count_avx2(window, n, stride, k, k_greater)
+    : simd_count_sse42(window, n, stride, k, k_greater);
+  return base + (upper ? n - count : count);
+}
+
+#endif  // BOOST_BTREE_SIMD_SEARCH
+
+} // namespace detail
+
+} // namespace boost
+
+#endif  // BOOST_BTREE_SIMD_SEARCH_HPP
@@ -26,59 +26,71 @@ namespace btree {
 //--------------------------------------------------------------------------------------//
 
 template <class Key, class T, class Compare = std::less<Key>,
-          class Allocator = std::allocator<std::pair<const Key, T> > >
+          class Allocator = std::allocator<std::pair<const Key, T> >,
+          class Search = branchless_search,
+          class Stats = no_order_statistics>
   class mbt_map;   // short for memory_btree_map
 
-template <class Key, class T, class Compare, class Allocator> inline
-  bool operator==(const mbt_map<Key,T,Compare,Allocator>& x,
-                  const mbt_map<Key,T,Compare,Allocator>& y)
+template <class Key, class T, class Compare, class Allocator, class Search,
+          class Stats> inline
+  bool operator==(const mbt_map<Key,T,Compare,Allocator,Search,Stats>& x,
+                  const mbt_map<Key,T,Compare,Allocator,Search,Stats>& y)
     { return x.size() == y.size()  && std::equal(x.begin(), x.end(), y.begin()); }
 
-template <class Key, class T, class Compare, class Allocator> inline
-  bool operator!=(const mbt_map<Key,T,Compare,Allocator>& x,
-                  const mbt_map<Key,T,Compare,Allocator>& y)  { return !(x == y); }
+template <class Key, class T, class Compare, class Allocator, class Search,
+          class Stats> inline
+  bool operator!=(const mbt_map<Key,T,Compare,Allocator,Search,Stats>& x,
+                  const mbt_map<Key,T,Compare,Allocator,Search,Stats>& y)  { return !(x == y); }
 
-template <class Key, class T, class Compare, class Allocator> inline
-  bool operator< (const mbt_map<Key,T,Compare,Allocator>& x,
-                  const mbt_map<Key,T,Compare,Allocator>& y)
+template <class Key, class T, class Compare, class Allocator, class Search,
+          class Stats> inline
+  bool operator< (const mbt_map<Key,T,Compare,Allocator,Search,Stats>& x,
+                  const mbt_map<Key,T,Compare,Allocator,Search,Stats>& y)
     { return std::lexicographical_compare(x.begin(), x.end(), y.begin(), y.end()); }
 
-template <class Key, class T, class Compare, class Allocator> inline
-  bool operator> (const mbt_map<Key,T,Compare,Allocator>& x,
-                  const mbt_map<Key,T,Compare,Allocator>& y)  { return y < x; }
+template <class Key, class T, class Compare, class Allocator, class Search,
+          class Stats> inline
+  bool operator> (const mbt_map<Key,T,Compare,Allocator,Search,Stats>& x,
+                  const mbt_map<Key,T,Compare,Allocator,Search,Stats>& y)  { return y < x; }
 
-template <class Key, class T, class Compare, class Allocator> inline
-  bool operator>=(const mbt_map<Key,T,Compare,Allocator>& x,
-                  const mbt_map<Key,T,Compare,Allocator>& y)  { return !(x < y); }
+template <class Key, class T, class Compare, class Allocator, class Search,
+          class Stats> inline
+  bool operator>=(const mbt_map<Key,T,Compare,Allocator,Search,Stats>& x,
+                  const mbt_map<Key,T,Compare,Allocator,Search,Stats>& y)  { return !(x < y); }
 
-template <class Key, class T, class Compare, class Allocator> inline
-  bool operator<=(const mbt_map<Key,T,Compare,Allocator>& x,
-                  const mbt_map<Key,T,Compare,Allocator>& y)  { return !(x > y);}
+template <class Key, class T, class Compare, class Allocator, class Search,
+          class Stats> inline
+  bool operator<=(const mbt_map<Key,T,Compare,Allocator,Search,Stats>& x,
+                  const mbt_map<Key,T,Compare,Allocator,Search,Stats>& y)  { return !(x > y);}
 
-template <class Key, class T, class Compare, class Allocator> inline
-  void swap(mbt_map<Key,T,Compare,Allocator>& x, mbt_map<Key,T,Compare,Allocator>& y)
-    { x.swap(y); }
+template <class Key, class T, class Compare, class Allocator, class Search,
+          class Stats> inline
+  void swap(mbt_map<Key,T,Compare,Allocator,Search,Stats>& x,
+            mbt_map<Key,T,Compare,Allocator,Search,Stats>& y) { x.swap(y); }
 
-template <class Key, class T, class Compare> class mbt_map_base;
+template <class Key, class T, class Compare, class Search,
+          class Stats> class mbt_map_base;
 
 //--------------------------------------------------------------------------------------//
 //                                  class mbt_map                                       //
 //--------------------------------------------------------------------------------------//
 
-template <class Key, class T, class Compare, class Allocator>
+template <class Key, class T, class Compare, class Allocator, class Search, class Stats>
 class mbt_map   // short for memory_btree_map
-  : public mbt_base<Key, mbt_map_base<Key,T,Compare>, Compare, Allocator>
+  : public mbt_base<Key, mbt_map_base<Key,T,Compare,Search,Stats>, Compare, Allocator>
 {
 public:
   typedef std::size_t size_type;
-  typedef typename mbt_base<Key,mbt_map_base<Key,T,Compare>,Compare,Allocator>::iterator
-    iterator;
-  typedef typename mbt_base<Key,mbt_map_base<Key,T,Compare>,Compare,Allocator>::value_type
-    value_type;
+  typedef typename mbt_base<Key,mbt_map_base<Key,T,Compare,Search,Stats>,Compare,
+    Allocator>::iterator  iterator;
+  typedef typename mbt_base<Key,mbt_map_base<Key,T,Compare,Search,Stats>,Compare,
+    Allocator>::const_iterator  const_iterator;
+  typedef typename mbt_base<Key,mbt_map_base<Key,T,Compare,Search,Stats>,Compare,
+    Allocator>::value_type  value_type;
 
   explicit mbt_map(size_type node_sz = default_node_size,
     const Compare& comp = Compare(), const Allocator& alloc = Allocator())
-      : mbt_base<Key,mbt_map_base<Key,T,Compare>,Compare,Allocator>
+      : mbt_base<Key,mbt_map_base<Key,T,Compare,Search,Stats>,Compare,Allocator>
           (node_sz, comp, alloc) {}
 
 
@@ -86,24 +98,25 @@ public:
     mbt_map(InputIterator first, InputIterator last,   // range constructor
             size_type node_sz = default_node_size,
             const Compare& comp = Compare(), const Allocator& alloc = Allocator())
-      : mbt_base<Key,mbt_map_base<Key,T,Compare>,Compare,Allocator>
+      : mbt_base<Key,mbt_map_base<Key,T,Compare,Search,Stats>,Compare,Allocator>
           (first, last, node_sz, comp, alloc) {}
 
-  mbt_map(const mbt_map<Key,T,Compare,Allocator>& x)  // copy constructor
-    : mbt_base<Key,mbt_map_base<Key,T,Compare>,Compare,Allocator>(x) {}
+  mbt_map(const mbt_map<Key,T,Compare,Allocator,Search,Stats>& x)  // copy constructor
+    : mbt_base<Key,mbt_map_base<Key,T,Compare,Search,Stats>,Compare,Allocator>(x) {}
 
-  mbt_map(mbt_map<Key,T,Compare,Allocator>&& x)       // move constructor
-    : mbt_base<Key,mbt_map_base<Key,T,Compare>,Compare,Allocator>() {this->swap(x);}
+  mbt_map(mbt_map<Key,T,Compare,Allocator,Search,Stats>&& x)       // move constructor
+    : mbt_base<Key,mbt_map_base<Key,T,Compare,Search,Stats>,Compare,Allocator>
+        (x.node_size(), x.key_comp(), x.get_allocator()) {this->swap(x);}
 
-  mbt_map<Key,T,Compare,Allocator>&
-  operator=(const mbt_map<Key,T,Compare,Allocator>& x)  // copy assignment
+  mbt_map<Key,T,Compare,Allocator,Search,Stats>&
+  operator=(const mbt_map<Key,T,Compare,Allocator,Search,Stats>& x)  // copy assignment
   {
-    mbt_base<Key,mbt_map_base<Key,T,Compare>,Compare,Allocator>::operator=(x);
+    mbt_base<Key,mbt_map_base<Key,T,Compare,Search,Stats>,Compare,Allocator>::operator=(x);
     return *this;
   }
 
-  mbt_map<Key,T,Compare,Allocator>&
-  operator=(mbt_map<Key,T,Compare,Allocator>&& x)     // move assignment
+  mbt_map<Key,T,Compare,Allocator,Search,Stats>&
+  operator=(mbt_map<Key,T,Compare,Allocator,Search,Stats>&& x)     // move assignment
   {
     this->swap(x);
     return *this;
@@ -122,6 +135,16 @@ public:
     insert(P&& x)
       { return m_insert_unique(std::forward<value_type>(x)); }
 
+  iterator  insert(const_iterator hint, const value_type& x)
+    { return this->m_insert_hint(hint, value_type(x)); }
+
+  iterator  insert(const_iterator hint, value_type&& x)
+    { return this->m_insert_hint(hint, std::move(x)); }
+
+  template <class... Args>
+  iterator  emplace_hint(const_iterator hint, Args&&... args)
+    { return this->m_insert_hint(hint, value_type(std::forward<Args>(args)...)); }
+
   template <class InputIterator>
     void insert(InputIterator first, InputIterator last)
   {
@@ -183,12 +206,14 @@ public:
 //                                class mbt_map_base                                    //
 //--------------------------------------------------------------------------------------//
 
-template <class Key, class T, class Compare>
+template <class Key, class T, class Compare, class Search, class Stats>
 class mbt_map_base : public mbt_map_common_base<Key, T, Compare>
 {
 protected:
   typedef typename boost::btree::mbt_map_common_base<Key, T, Compare>::unique
     uniqueness;
+  typedef Search search_policy;
+  typedef Stats statistics_policy;
 };
 
 //--------------------------------------------------------------------------------------//
@@ -198,59 +223,71 @@ protected:
 //--------------------------------------------------------------------------------------//
 
 template <class Key, class T, class Compare = std::less<Key>,
-          class Allocator = std::allocator<std::pair<const Key, T> > >
+          class Allocator = std::allocator<std::pair<const Key, T> >,
+          class Search = branchless_search,
+          class Stats = no_order_statistics>
   class mbt_multimap;   // short for memory_btree_multimap
 
-template <class Key, class T, class Compare, class Allocator> inline
-  bool operator==(const mbt_multimap<Key,T,Compare,Allocator>& x,
-                  const mbt_multimap<Key,T,Compare,Allocator>& y)
+template <class Key, class T, class Compare, class Allocator, class Search,
+          class Stats> inline
+  bool operator==(const mbt_multimap<Key,T,Compare,Allocator,Search,Stats>& x,
+                  const mbt_multimap<Key,T,Compare,Allocator,Search,Stats>& y)
     { return x.size() == y.size()  && std::equal(x.begin(), x.end(), y.begin()); }
 
-template <class Key, class T, class Compare, class Allocator> inline
-  bool operator!=(const mbt_multimap<Key,T,Compare,Allocator>& x,
-                  const mbt_multimap<Key,T,Compare,Allocator>& y)  { return !(x == y); }
+template <class Key, class T, class Compare, class Allocator, class Search,
+          class Stats> inline
+  bool operator!=(const mbt_multimap<Key,T,Compare,Allocator,Search,Stats>& x,
+                  const mbt_multimap<Key,T,Compare,Allocator,Search,Stats>& y)  { return !(x == y); }
 
-template <class Key, class T, class Compare, class Allocator> inline
-  bool operator< (const mbt_multimap<Key,T,Compare,Allocator>& x,
-                  const mbt_multimap<Key,T,Compare,Allocator>& y)
+template <class Key, class T, class Compare, class Allocator, class Search,
+          class Stats> inline
+  bool operator< (const mbt_multimap<Key,T,Compare,Allocator,Search,Stats>& x,
+                  const mbt_multimap<Key,T,Compare,Allocator,Search,Stats>& y)
     { return std::lexicographical_compare(x.begin(), x.end(), y.begin(), y.end()); }
 
-template <class Key, class T, class Compare, class Allocator> inline
-  bool operator> (const mbt_multimap<Key,T,Compare,Allocator>& x,
-                  const mbt_multimap<Key,T,Compare,Allocator>& y)  { return y < x; }
+template <class Key, class T, class Compare, class Allocator, class Search,
+          class Stats> inline
+  bool operator> (const mbt_multimap<Key,T,Compare,Allocator,Search,Stats>& x,
+                  const mbt_multimap<Key,T,Compare,Allocator,Search,Stats>& y)  { return y < x; }
 
-template <class Key, class T, class Compare, class Allocator> inline
-  bool operator>=(const mbt_multimap<Key,T,Compare,Allocator>& x,
-                  const mbt_multimap<Key,T,Compare,Allocator>& y)  { return !(x < y); }
+template <class Key, class T, class Compare, class Allocator, class Search,
+          class Stats> inline
+  bool operator>=(const mbt_multimap<Key,T,Compare,Allocator,Search,Stats>& x,
+                  const mbt_multimap<Key,T,Compare,Allocator,Search,Stats>& y)  { return !(x < y); }
 
-template <class Key, class T, class Compare, class Allocator> inline
-  bool operator<=(const mbt_multimap<Key,T,Compare,Allocator>& x,
-                  const mbt_multimap<Key,T,Compare,Allocator>& y)  { return !(x > y);}
+template <class Key, class T, class Compare, class Allocator, class Search,
+          class Stats> inline
+  bool operator<=(const mbt_multimap<Key,T,Compare,Allocator,Search,Stats>& x,
+                  const mbt_multimap<Key,T,Compare,Allocator,Search,Stats>& y)  { return !(x > y);}
 
-template <class Key, class T, class Compare, class Allocator> inline
-  void swap(mbt_multimap<Key,T,Compare,Allocator>& x,
-            mbt_multimap<Key,T,Compare,Allocator>& y) { x.swap(y); }
+template <class Key, class T, class Compare, class Allocator, class Search,
+          class Stats> inline
+  void swap(mbt_multimap<Key,T,Compare,Allocator,Search,Stats>& x,
+            mbt_multimap<Key,T,Compare,Allocator,Search,Stats>& y) { x.swap(y); }
 
-template <class Key, class T, class Compare> class mbt_multimap_base;
+template <class Key, class T, class Compare, class Search,
+          class Stats> class mbt_multimap_base;
 
 //--------------------------------------------------------------------------------------//
 //                               class mbt_multimap                                     //
 //--------------------------------------------------------------------------------------//
 
-template <class Key, class T, class Compare, class Allocator>
+template <class Key, class T, class Compare, class Allocator, class Search, class Stats>
 class mbt_multimap   // short for memory_btree_multimap
-  : public mbt_base<Key, mbt_multimap_base<Key,T,Compare>, Compare, Allocator>
+  : public mbt_base<Key, mbt_multimap_base<Key,T,Compare,Search,Stats>, Compare, Allocator>
 {
 public:
   typedef std::size_t size_type;
-  typedef typename mbt_base<Key,mbt_multimap_base<Key,T,Compare>,Compare,Allocator>::iterator
-    iterator;
-  typedef typename mbt_base<Key,mbt_multimap_base<Key,T,Compare>,Compare,Allocator>::value_type
-    value_type;
+  typedef typename mbt_base<Key,mbt_multimap_base<Key,T,Compare,Search,Stats>,Compare,
+    Allocator>::iterator  iterator;
+  typedef typename mbt_base<Key,mbt_multimap_base<Key,T,Compare,Search,Stats>,Compare,
+    Allocator>::const_iterator  const_iterator;
+  typedef typename mbt_base<Key,mbt_multimap_base<Key,T,Compare,Search,Stats>,Compare,
+    Allocator>::value_type  value_type;
 
   explicit mbt_multimap(size_type node_sz = default_node_size,
     const Compare& comp = Compare(), const Allocator& alloc = Allocator())
-      : mbt_base<Key,mbt_multimap_base<Key,T,Compare>,Compare,Allocator>
+      : mbt_base<Key,mbt_multimap_base<Key,T,Compare,Search,Stats>,Compare,Allocator>
           (node_sz, comp, alloc) {}
 
 
@@ -258,24 +295,25 @@ public:
     mbt_multimap(InputIterator first, InputIterator last,   // range constructor
             size_type node_sz = default_node_size,
             const Compare& comp = Compare(), const Allocator& alloc = Allocator())
-      : mbt_base<Key,mbt_multimap_base<Key,T,Compare>,Compare,Allocator>
+      : mbt_base<Key,mbt_multimap_base<Key,T,Compare,Search,Stats>,Compare,Allocator>
           (first, last, node_sz, comp, alloc) {}
 
-  mbt_multimap(const mbt_multimap<Key,T,Compare,Allocator>& x)  // copy constructor
-    : mbt_base<Key,mbt_multimap_base<Key,T,Compare>,Compare,Allocator>(x) {}
+  mbt_multimap(const mbt_multimap<Key,T,Compare,Allocator,Search,Stats>& x)  // copy constructor
+    : mbt_base<Key,mbt_multimap_base<Key,T,Compare,Search,Stats>,Compare,Allocator>(x) {}
 
-  mbt_multimap(mbt_multimap<Key,T,Compare,Allocator>&& x)       // move constructor
-    : mbt_base<Key,mbt_multimap_base<Key,T,Compare>,Compare,Allocator>() {this->swap(x);}
+  mbt_multimap(mbt_multimap<Key,T,Compare,Allocator,Search,Stats>&& x)       // move constructor
+    : mbt_base<Key,mbt_multimap_base<Key,T,Compare,Search,Stats>,Compare,Allocator>
+        (x.node_size(), x.key_comp(), x.get_allocator()) {this->swap(x);}
 
-  mbt_multimap<Key,T,Compare,Allocator>&
-  operator=(const mbt_multimap<Key,T,Compare,Allocator>& x)  // copy assignment
+  mbt_multimap<Key,T,Compare,Allocator,Search,Stats>&
+  operator=(const mbt_multimap<Key,T,Compare,Allocator,Search,Stats>& x)  // copy assignment
   {
-    mbt_base<Key,mbt_multimap_base<Key,T,Compare>,Compare,Allocator>::operator=(x);
+    mbt_base<Key,mbt_multimap_base<Key,T,Compare,Search,Stats>,Compare,Allocator>::operator=(x);
     return *this;
   }
 
-  mbt_multimap<Key,T,Compare,Allocator>&
-  operator=(mbt_multimap<Key,T,Compare,Allocator>&& x)     // move assignment
+  mbt_multimap<Key,T,Compare,Allocator,Search,Stats>&
+  operator=(mbt_multimap<Key,T,Compare,Allocator,Search,Stats>&& x)     // move assignment
   {
     this->swap(x);
     return *this;
@@ -286,6 +324,16 @@ public:
   template <class P>
   iterator  insert(P&& x)                       { return m_insert_non_unique(x); }
 
+  iterator  insert(const_iterator hint, const value_type& x)
+    { return this->m_insert_hint(hint, value_type(x)); }
+
+  iterator  insert(const_iterator hint, value_type&& x)
+    { return this->m_insert_hint(hint, std::move(x)); }
+
+  template <class... Args>
+  iterator  emplace_hint(const_iterator hint, Args&&... args)
+    { return this->m_insert_hint(hint, value_type(std::forward<Args>(args)...)); }
+
   template <class InputIterator>
     void insert(InputIterator first, InputIterator last)
   {
@@ -299,14 +347,36 @@ public:
 //                             class mbt_multimap_base                                  //
 //--------------------------------------------------------------------------------------//
 
-template <class Key, class T, class Compare>
+template <class Key, class T, class Compare, class Search, class Stats>
 class mbt_multimap_base : public mbt_map_common_base<Key, T, Compare>
 {
 protected:
   typedef typename boost::btree::mbt_map_common_base<Key, T, Compare>::non_unique
     uniqueness;
+  typedef Search search_policy;
+  typedef Stats statistics_policy;
 };
 
+//--------------------------------------------------------------------------------------//
+//                                  std::pmr aliases                                    //
+//--------------------------------------------------------------------------------------//
+
+#ifdef BOOST_BTREE_HAS_PMR
+namespace pmr
+{
+  template <class Key, class T, class Compare = std::less<Key>,
+            class Search = branchless_search,
+            class Stats = no_order_statistics>
+    using mbt_map = boost::btree::mbt_map<Key, T, Compare,
+      std::pmr::polymorphic_allocator<std::pair<const Key, T> >, Search, Stats>;
+  template <class Key, class T, class Compare = std::less<Key>,
+            class Search = branchless_search,
+            class Stats = no_order_statistics>
+    using mbt_multimap = boost::btree::mbt_multimap<Key, T, Compare,
+      std::pmr::polymorphic_allocator<std::pair<const Key, T> >, Search, Stats>;
+}
+#endif
+
 }  // namespace btree
 }  // namespace boost
 
@@ -26,81 +26,87 @@ namespace btree {
 //--------------------------------------------------------------------------------------//
 
 template <class Key, class Compare = std::less<Key>,
-          class Allocator = std::allocator<Key> >
+          class Allocator = std::allocator<Key>, class Search = branchless_search,
+          class Stats = no_order_statistics>
   class mbt_set;   // short for memory_btree_set
 
-template <class Key, class Compare, class Allocator> inline
-  bool operator==(const mbt_set<Key,Compare,Allocator>& x,
-                  const mbt_set<Key,Compare,Allocator>& y)
+template <class Key, class Compare, class Allocator, class Search, class Stats> inline
+  bool operator==(const mbt_set<Key,Compare,Allocator,Search,Stats>& x,
+                  const mbt_set<Key,Compare,Allocator,Search,Stats>& y)
     { return x.size() == y.size()  && std::equal(x.begin(), x.end(), y.begin()); }
 
-template <class Key, class Compare, class Allocator> inline
-  bool operator!=(const mbt_set<Key,Compare,Allocator>& x,
-                  const mbt_set<Key,Compare,Allocator>& y)  { return !(x == y); }
+template <class Key, class Compare, class Allocator, class Search, class Stats> inline
+  bool operator!=(const mbt_set<Key,Compare,Allocator,Search,Stats>& x,
+                  const mbt_set<Key,Compare,Allocator,Search,Stats>& y)  { return !(x == y); }
 
-template <class Key, class Compare, class Allocator> inline
-  bool operator< (const mbt_set<Key,Compare,Allocator>& x,
-                  const mbt_set<Key,Compare,Allocator>& y)
+template <class Key, class Compare, class Allocator, class Search, class Stats> inline
+  bool operator< (const mbt_set<Key,Compare,Allocator,Search,Stats>& x,
+                  const mbt_set<Key,Compare,Allocator,Search,Stats>& y)
     { return std::lexicographical_compare(x.begin(), x.end(), y.begin(), y.end()); }
 
-template <class Key, class Compare, class Allocator> inline
-  bool operator> (const mbt_set<Key,Compare,Allocator>& x,
-                  const mbt_set<Key,Compare,Allocator>& y)  { return y < x; }
+template <class Key, class Compare, class Allocator, class Search, class Stats> inline
+  bool operator> (const mbt_set<Key,Compare,Allocator,Search,Stats>& x,
+                  const mbt_set<Key,Compare,Allocator,Search,Stats>& y)  { return y < x; }
 
-template <class Key, class Compare, class Allocator> inline
-  bool operator>=(const mbt_set<Key,Compare,Allocator>& x,
-                  const mbt_set<Key,Compare,Allocator>& y)  { return !(x < y); }
+template <class Key, class Compare, class Allocator, class Search, class Stats> inline
+  bool operator>=(const mbt_set<Key,Compare,Allocator,Search,Stats>& x,
+                  const mbt_set<Key,Compare,Allocator,Search,Stats>& y)  { return !(x < y); }
 
-template <class Key, class Compare, class Allocator> inline
-  bool operator<=(const mbt_set<Key,Compare,Allocator>& x,
-                  const mbt_set<Key,Compare,Allocator>& y)  { return !(x > y);}
+template <class Key, class Compare, class Allocator, class Search, class Stats> inline
+  bool operator<=(const mbt_set<Key,Compare,Allocator,Search,Stats>& x,
+                  const mbt_set<Key,Compare,Allocator,Search,Stats>& y)  { return !(x > y);}
 
-template <class Key, class Compare, class Allocator> inline
-  void swap(mbt_set<Key,Compare,Allocator>& x, mbt_set<Key,Compare,Allocator>& y)
-    { x.swap(y); }
+template <class Key, class Compare, class Allocator, class Search, class Stats> inline
+  void swap(mbt_set<Key,Compare,Allocator,Search,Stats>& x,
+            mbt_set<Key,Compare,Allocator,Search,Stats>& y) { x.swap(y); }
 
-template <class Key, class Compare> class mbt_set_base;
+template <class Key, class Compare, class Search, class Stats> class mbt_set_base;
 
 //--------------------------------------------------------------------------------------//
 //                                  class mbt_set                                       //
 //--------------------------------------------------------------------------------------//
 
-template <class Key, class Compare, class Allocator>
+template <class Key, class Compare, class Allocator, class Search, class Stats>
 class mbt_set   // short for memory_btree_set
-  : public mbt_base<Key, mbt_set_base<Key,Compare>, Compare, Allocator>
+  : public mbt_base<Key, mbt_set_base<Key,Compare,Search,Stats>, Compare, Allocator>
 {
 public:
   typedef std::size_t size_type;
-  typedef typename mbt_base<Key,mbt_set_base<Key,Compare>,Compare,Allocator>::iterator
-    iterator;
-  typedef typename mbt_base<Key,mbt_set_base<Key,Compare>,Compare,Allocator>::value_type
-    value_type;
+  typedef typename mbt_base<Key,mbt_set_base<Key,Compare,Search,Stats>,Compare,
+    Allocator>::iterator  iterator;
+  typedef typename mbt_base<Key,mbt_set_base<Key,Compare,Search,Stats>,Compare,
+    Allocator>::const_iterator  const_iterator;
+  typedef typename mbt_base<Key,mbt_set_base<Key,Compare,Search,Stats>,Compare,
+    Allocator>::value_type  value_type;
 
   explicit mbt_set(size_type node_sz = default_node_size,
     const Compare& comp = Compare(), const Allocator& alloc = Allocator())
-      : mbt_base<Key,mbt_set_base<Key,Compare>,Compare,Allocator>(node_sz, comp, alloc) {}
+      : mbt_base<Key,mbt_set_base<Key,Compare,Search,Stats>,Compare,Allocator>
+         (node_sz, comp, alloc) {}
 
    template <class InputIterator>
     mbt_set(InputIterator first, InputIterator last,   // range constructor
             size_type node_sz = default_node_size,
             const Compare& comp = Compare(), const Allocator& alloc = Allocator())
-      : mbt_base<Key,mbt_set_base<Key,Compare>,Compare,Allocator>(first, last, node_sz, comp, alloc) {}
+      : mbt_base<Key,mbt_set_base<Key,Compare,Search,Stats>,Compare,Allocator>
+         (first, last, node_sz, comp, alloc) {}
 
-  mbt_set(const mbt_set<Key,Compare,Allocator>& x)  // copy constructor
-    : mbt_base<Key,mbt_set_base<Key,Compare>,Compare,Allocator>(x) {}
+  mbt_set(const mbt_set<Key,Compare,Allocator,Search,Stats>& x)  // copy constructor
+    : mbt_base<Key,mbt_set_base<Key,Compare,Search,Stats>,Compare,Allocator>(x) {}
 
-  mbt_set(mbt_set<Key,Compare,Allocator>&& x)       // move constructor
-    : mbt_base<Key,mbt_set_base<Key,Compare>,Compare,Allocator>() {this->swap(x);}
+  mbt_set(mbt_set<Key,Compare,Allocator,Search,Stats>&& x)       // move constructor
+    : mbt_base<Key,mbt_set_base<Key,Compare,Search,Stats>,Compare,Allocator>
+        (x.node_size(), x.key_comp(), x.get_allocator()) {this->swap(x);}
 
-  mbt_set<Key,Compare,Allocator>&
-  operator=(const mbt_set<Key,Compare,Allocator>& x)  // copy assignment
+  mbt_set<Key,Compare,Allocator,Search,Stats>&
+  operator=(const mbt_set<Key,Compare,Allocator,Search,Stats>& x)  // copy assignment
   {
-    mbt_base<Key,mbt_set_base<Key,Compare>,Compare,Allocator>::operator=(x);
+    mbt_base<Key,mbt_set_base<Key,Compare,Search,Stats>,Compare,Allocator>::operator=(x);
     return *this;
   }
 
-  mbt_set<Key,Compare,Allocator>&
-  operator=(mbt_set<Key,Compare,Allocator>&& x)     // move assignment
+  mbt_set<Key,Compare,Allocator,Search,Stats>&
+  operator=(mbt_set<Key,Compare,Allocator,Search,Stats>&& x)     // move assignment
   {
     this->swap(x);
     return *this;
@@ -110,7 +116,17 @@ public:
     { return m_insert_unique(x); }
 
   std::pair<iterator,bool>  insert(value_type&& x)
-    { return m_insert_unique(x); }
+    { return m_insert_unique(std::move(x)); }
+
+  iterator  insert(const_iterator hint, const value_type& x)
+    { return this->m_insert_hint(hint, value_type(x)); }
+
+  iterator  insert(const_iterator hint, value_type&& x)
+    { return this->m_insert_hint(hint, std::move(x)); }
+
+  template <class... Args>
+  iterator  emplace_hint(const_iterator hint, Args&&... args)
+    { return this->m_insert_hint(hint, value_type(std::forward<Args>(args)...)); }
 
   template <class InputIterator>
     void insert(InputIterator first, InputIterator last)
@@ -153,12 +169,14 @@ public:
 //                                class btree_set_base                                  //
 //--------------------------------------------------------------------------------------//
 
-template <class Key, class Compare>
+template <class Key, class Compare, class Search, class Stats>
 class mbt_set_base : public mbt_set_common_base<Key, Compare>
 {
 protected:
   typedef typename boost::btree::mbt_set_common_base<Key, Compare>::unique
     uniqueness;
+  typedef Search search_policy;
+  typedef Stats statistics_policy;
 };
 
 //--------------------------------------------------------------------------------------//
@@ -168,59 +186,62 @@ protected:
 //--------------------------------------------------------------------------------------//
 
 template <class Key, class Compare = std::less<Key>,
-          class Allocator = std::allocator<Key> >
+          class Allocator = std::allocator<Key>, class Search = branchless_search,
+          class Stats = no_order_statistics>
   class mbt_multiset;   // short for memory_btree_multiset
 
-template <class Key, class Compare, class Allocator> inline
-  bool operator==(const mbt_multiset<Key,Compare,Allocator>& x,
-                  const mbt_multiset<Key,Compare,Allocator>& y)
+template <class Key, class Compare, class Allocator, class Search, class Stats> inline
+  bool operator==(const mbt_multiset<Key,Compare,Allocator,Search,Stats>& x,
+                  const mbt_multiset<Key,Compare,Allocator,Search,Stats>& y)
     { return x.size() == y.size()  && std::equal(x.begin(), x.end(), y.begin()); }
 
-template <class Key, class Compare, class Allocator> inline
-  bool operator!=(const mbt_multiset<Key,Compare,Allocator>& x,
-                  const mbt_multiset<Key,Compare,Allocator>& y)  { return !(x == y); }
+template <class Key, class Compare, class Allocator, class Search, class Stats> inline
+  bool operator!=(const mbt_multiset<Key,Compare,Allocator,Search,Stats>& x,
+                  const mbt_multiset<Key,Compare,Allocator,Search,Stats>& y)  { return !(x == y); }
 
-template <class Key, class Compare, class Allocator> inline
-  bool operator< (const mbt_multiset<Key,Compare,Allocator>& x,
-                  const mbt_multiset<Key,Compare,Allocator>& y)
+template <class Key, class Compare, class Allocator, class Search, class Stats> inline
+  bool operator< (const mbt_multiset<Key,Compare,Allocator,Search,Stats>& x,
+                  const mbt_multiset<Key,Compare,Allocator,Search,Stats>& y)
     { return std::lexicographical_compare(x.begin(), x.end(), y.begin(), y.end()); }
 
-template <class Key, class Compare, class Allocator> inline
-  bool operator> (const mbt_multiset<Key,Compare,Allocator>& x,
-                  const mbt_multiset<Key,Compare,Allocator>& y)  { return y < x; }
+template <class Key, class Compare, class Allocator, class Search, class Stats> inline
+  bool operator> (const mbt_multiset<Key,Compare,Allocator,Search,Stats>& x,
+                  const mbt_multiset<Key,Compare,Allocator,Search,Stats>& y)  { return y < x; }
 
-template <class Key, class Compare, class Allocator> inline
-  bool operator>=(const mbt_multiset<Key,Compare,Allocator>& x,
-                  const mbt_multiset<Key,Compare,Allocator>& y)  { return !(x < y); }
+template <class Key, class Compare, class Allocator, class Search, class Stats> inline
+  bool operator>=(const mbt_multiset<Key,Compare,Allocator,Search,Stats>& x,
+                  const mbt_multiset<Key,Compare,Allocator,Search,Stats>& y)  { return !(x < y); }
 
-template <class Key, class Compare, class Allocator> inline
-  bool operator<=(const mbt_multiset<Key,Compare,Allocator>& x,
-                  const mbt_multiset<Key,Compare,Allocator>& y)  { return !(x > y);}
+template <class Key, class Compare, class Allocator, class Search, class Stats> inline
+  bool operator<=(const mbt_multiset<Key,Compare,Allocator,Search,Stats>& x,
+                  const mbt_multiset<Key,Compare,Allocator,Search,Stats>& y)  { return !(x > y);}
 
-template <class Key, class Compare, class Allocator> inline
-  void swap(mbt_multiset<Key,Compare,Allocator>& x,
-            mbt_multiset<Key,Compare,Allocator>& y) { x.swap(y); }
+template <class Key, class Compare, class Allocator, class Search, class Stats> inline
+  void swap(mbt_multiset<Key,Compare,Allocator,Search,Stats>& x,
+            mbt_multiset<Key,Compare,Allocator,Search,Stats>& y) { x.swap(y); }
 
-template <class Key, class Compare> class mbt_multiset_base;
+template <class Key, class Compare, class Search, class Stats> class mbt_multiset_base;
 
 //--------------------------------------------------------------------------------------//
 //                                  class mbt_multiset                                       //
 //--------------------------------------------------------------------------------------//
 
-template <class Key, class Compare, class Allocator>
+template <class Key, class Compare, class Allocator, class Search, class Stats>
 class mbt_multiset   // short for memory_btree_multiset
-  : public mbt_base<Key, mbt_multiset_base<Key,Compare>, Compare, Allocator>
+  : public mbt_base<Key, mbt_multiset_base<Key,Compare,Search,Stats>, Compare, Allocator>
 {
 public:
   typedef std::size_t size_type;
-  typedef typename mbt_base<Key,mbt_multiset_base<Key,Compare>,Compare,Allocator>::iterator
-    iterator;
-  typedef typename mbt_base<Key,mbt_multiset_base<Key,Compare>,Compare,Allocator>::value_type
-    value_type;
+  typedef typename mbt_base<Key,mbt_multiset_base<Key,Compare,Search,Stats>,Compare,
+    Allocator>::iterator  iterator;
+  typedef typename mbt_base<Key,mbt_multiset_base<Key,Compare,Search,Stats>,Compare,
+    Allocator>::const_iterator  const_iterator;
+  typedef typename mbt_base<Key,mbt_multiset_base<Key,Compare,Search,Stats>,Compare,
+    Allocator>::value_type  value_type;
 
   explicit mbt_multiset(size_type node_sz = default_node_size,
     const Compare& comp = Compare(), const Allocator& alloc = Allocator())
-      : mbt_base<Key,mbt_multiset_base<Key,Compare>,Compare,Allocator>
+      : mbt_base<Key,mbt_multiset_base<Key,Compare,Search,Stats>,Compare,Allocator>
          (node_sz, comp, alloc) {}
 
 
@@ -228,24 +249,25 @@ public:
     mbt_multiset(InputIterator first, InputIterator last,   // range constructor
             size_type node_sz = default_node_size,
             const Compare& comp = Compare(), const Allocator& alloc = Allocator())
-      : mbt_base<Key,mbt_multiset_base<Key,Compare>,Compare,Allocator>
+      : mbt_base<Key,mbt_multiset_base<Key,Compare,Search,Stats>,Compare,Allocator>
          (first, last, node_sz, comp, alloc) {}
 
-  mbt_multiset(const mbt_multiset<Key,Compare,Allocator>& x)  // copy constructor
-    : mbt_base<Key,mbt_multiset_base<Key,Compare>,Compare,Allocator>(x) {}
+  mbt_multiset(const mbt_multiset<Key,Compare,Allocator,Search,Stats>& x)  // copy constructor
+    : mbt_base<Key,mbt_multiset_base<Key,Compare,Search,Stats>,Compare,Allocator>(x) {}
 
-  mbt_multiset(mbt_multiset<Key,Compare,Allocator>&& x)       // move constructor
-    : mbt_base<Key,mbt_multiset_base<Key,Compare>,Compare,Allocator>() {this->swap(x);}
+  mbt_multiset(mbt_multiset<Key,Compare,Allocator,Search,Stats>&& x)       // move constructor
+    : mbt_base<Key,mbt_multiset_base<Key,Compare,Search,Stats>,Compare,Allocator>
+        (x.node_size(), x.key_comp(), x.get_allocator()) {this->swap(x);}
 
-  mbt_multiset<Key,Compare,Allocator>&
-  operator=(const mbt_multiset<Key,Compare,Allocator>& x)     // copy assignment
+  mbt_multiset<Key,Compare,Allocator,Search,Stats>&
+  operator=(const mbt_multiset<Key,Compare,Allocator,Search,Stats>& x)     // copy assignment
   {
-    mbt_base<Key,mbt_multiset_base<Key,Compare>,Compare,Allocator>::operator=(x);
+    mbt_base<Key,mbt_multiset_base<Key,Compare,Search,Stats>,Compare,Allocator>::operator=(x);
     return *this;
   }
 
-  mbt_multiset<Key,Compare,Allocator>&
-  operator=(mbt_multiset<Key,Compare,Allocator>&& x)          // move assignment
+  mbt_multiset<Key,Compare,Allocator,Search,Stats>&
+  operator=(mbt_multiset<Key,Compare,Allocator,Search,Stats>&& x)          // move assignment
   {
     this->swap(x);
     return *this;
@@ -255,7 +277,17 @@ public:
     { return m_insert_non_unique(x); }
 
   iterator  insert(value_type&& x)
-    { return m_insert_non_unique(x); }
+    { return m_insert_non_unique(std::move(x)); }
+
+  iterator  insert(const_iterator hint, const value_type& x)
+    { return this->m_insert_hint(hint, value_type(x)); }
+
+  iterator  insert(const_iterator hint, value_type&& x)
+    { return this->m_insert_hint(hint, std::move(x)); }
+
+  template <class... Args>
+  iterator  emplace_hint(const_iterator hint, Args&&... args)
+    { return this->m_insert_hint(hint, value_type(std::forward<Args>(args)...)); }
 
   template <class InputIterator>
     void insert(InputIterator first, InputIterator last)
@@ -270,14 +302,36 @@ public:
 //                             class btree_multiset_base                                //
 //--------------------------------------------------------------------------------------//
 
-template <class Key, class Compare>
+template <class Key, class Compare, class Search, class Stats>
 class mbt_multiset_base : public mbt_set_common_base<Key, Compare>
 {
 protected:
   typedef typename boost::btree::mbt_set_common_base<Key, Compare>::non_unique
     uniqueness;
+  typedef Search search_policy;
+  typedef Stats statistics_policy;
 };
 
+//--------------------------------------------------------------------------------------//
+//                                  std::pmr aliases                                    //
+//--------------------------------------------------------------------------------------//
+
+#ifdef BOOST_BTREE_HAS_PMR
+namespace pmr
+{
+  template <class Key, class Compare = std::less<Key>,
+            class Search = branchless_search,
+            class Stats = no_order_statistics>
+    using mbt_set = boost::btree::mbt_set<Key, Compare,
+      std::pmr::polymorphic_allocator<Key>, Search, Stats>;
+  template <class Key, class Compare = std::less<Key>,
+            class Search = branchless_search,
+            class Stats = no_order_statistics>
+    using mbt_multiset = boost::btree::mbt_multiset<Key, Compare,
+      std::pmr::polymorphic_allocator<Key>, Search, Stats>;
+}
+#endif
+
 }  // namespace btree
 }  // namespace boost
 
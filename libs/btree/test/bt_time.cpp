@@ -21,6 +21,8 @@
 #include <cstring>
 #include <cstdlib>  // for atol()
 #include <map>
+#include <vector>
+#include <thread>
 
 #include <boost/test/included/prg_exec_monitor.hpp>
 
@@ -36,11 +38,15 @@ namespace
   long initial_n;
   long seed = 1;
   long lg = 0;
+  long scans = 1;
+  long churn_rounds = 0;
+  int find_threads = 0;
   int node_sz = boost::btree::default_node_size;
   bool do_create (true);
   bool do_preload (false);
   bool do_insert (true);
   bool do_pack (false);
+  bool do_bulk (false);
   bool do_find (true);
   bool do_iterate (true);
   bool do_erase (true);
@@ -105,6 +111,97 @@ namespace
     char_vector_type::size_type _index;
   };
 
+  template <class BT>
+  void find_keys(const BT& bt, const std::vector<typename BT::key_type>& keys,
+    std::size_t start, long& not_found)
+  {
+    // finds every key, starting at keys[start] so threads don't run in lockstep
+    not_found = 0;
+    for (std::size_t i = 0; i < keys.size(); ++i)
+    {
+      if (bt.find(keys[(start + i) % keys.size()]) == bt.end())
+        ++not_found;
+    }
+  }
+
+  template <class BT, class RNG, class KeyGen>
+  void concurrent_find_test(const BT& bt, RNG& rng, KeyGen& key)
+  {
+    // the key generators aren't thread safe, so generate the keys up front
+    std::vector<typename BT::key_type> keys;
+    keys.reserve(n);
+    rng.seed(seed);
+    for (long i = 1; i <= n; ++i)
+      keys.push_back(key());
+
+    btree::run_timer t(3);
+    for (int thread_ct = 1; thread_ct <= find_threads; thread_ct *= 2)
+    {
+      cout << "\nfinding " << n << " btree elements in each of " << thread_ct
+           << " threads..." << endl;
+      std::vector<std::thread> threads;
+      std::vector<long> not_found(thread_ct);
+      t.start();
+      for (int i = 0; i < thread_ct; ++i)
+        threads.push_back(std::thread(find_keys<BT>, std::cref(bt), std::cref(keys),
+          i * (keys.size() / thread_ct), std::ref(not_found[i])));
+      for (int i = 0; i < thread_ct; ++i)
+        threads[i].join();
+      btree::times_t tm = t.stop();
+      cout << "  finds complete" << endl;
+      t.report();
+      if (tm.wall)
+        cout << "  " << (n * thread_ct) / (tm.wall / sec) << " finds per sec" << endl;
+      for (int i = 0; i < thread_ct; ++i)
+        if (not_found[i])
+          throw std::runtime_error("btree concurrent find() returned end()");
+    }
+  }
+
+  template <class BT, class RNG, class KeyGen>
+  void churn_test(const BT& bt, RNG& rng, KeyGen& key, double min_fill)
+  {
+    // each round erases n/2 random keys and inserts n/4, so the tree shrinks while
+    // its keys change
+    cout << "\nerase churn, min_fill " << min_fill * 100 << "%..." << endl;
+    BT bt2(bt);
+    bt2.min_fill(min_fill);
+    btree::run_timer t(3);
+    rng.seed(seed);
+    t.start();
+    for (long round = 1; round <= churn_rounds; ++round)
+    {
+      for (long i = 1; i <= n/2; ++i)
+        bt2.erase(key());
+      for (long i = 1; i <= n/4; ++i)
+        bt2.insert(typename BT::value_type(key(), i));
+      cout << "  round " << round << ": " << bt2.size() << " elements, "
+           << bt2.node_count() << " nodes, height " << bt2.height() << ", ";
+      if (bt2.size())
+        cout << double(bt2.node_count()) * bt2.node_size() / bt2.size()
+             << " bytes per element";
+      cout << endl;
+    }
+    t.stop();
+    t.report();
+
+    cout << "compacting..." << endl;
+    t.start();
+    std::size_t released = bt2.compact();
+    t.stop();
+    cout << "  " << bt2.node_count() << " nodes, height " << bt2.height() << ", "
+         << double(bt2.node_count()) * bt2.node_size() / bt2.size()
+         << " bytes per element, " << released << " bytes released" << endl;
+    t.report();
+
+    cout << "shrinking to fit..." << endl;
+    t.start();
+    released = bt2.shrink_to_fit();
+    t.stop();
+    cout << "  " << released << " bytes released" << endl;
+    t.report();
+  }
+
   template <class BT, class RNG, class KeyGen>
   void test(BT& bt, RNG& rng, KeyGen& key)
   {
@@ -129,6 +226,51 @@ namespace
         t.report();
       }
 
+      if (do_bulk)
+      {
+        std::vector<typename BT::value_type> sorted(bt.begin(), bt.end());
+
+        cout << "\ninserting " << sorted.size() << " sorted btree elements..." << endl;
+        t.start();
+        {
+          BT bt2(node_sz);
+          for (typename std::vector<typename BT::value_type>::const_iterator
+                 it = sorted.begin(); it != sorted.end(); ++it)
+            bt2.insert(*it);
+          t.stop();
+          cout << "  inserts complete, height " << bt2.height() << endl;
+        }
+        t.report();
+
+        cout << "\nbulk loading " << sorted.size() << " sorted btree elements..." << endl;
+        t.start();
+        {
+          BT bt2(sorted.begin(), sorted.end(), node_sz);
+          t.stop();
+          cout << "  bulk load complete, height " << bt2.height() << endl;
+          if (bt2.size() != sorted.size())
+            throw std::runtime_error("btree bulk load size error");
+        }
+        t.report();
+
+        cout << "\ncopying " << bt.size() << " btree elements..." << endl;
+        t.start();
+        {
+          BT bt2(bt);
+          t.stop();
+          cout << "  copy complete, height " << bt2.height() << endl;
+          if (bt2.size() != bt.size())
+            throw std::runtime_error("btree copy size error");
+        }
+        t.report();
+      }
+
+      if (churn_rounds)
+      {
+        churn_test(bt, rng, key, 0.0);
+        churn_test(bt, rng, key, btree::default_min_fill);
+      }
+
 //      if (do_pack)
 //      {
 //        cout << "\npacking btree..." << endl;
@@ -158,22 +300,32 @@ namespace
 
       if (do_iterate)
       {
-        cout << "\niterating over " << bt.size() << " btree elements..." << endl;
+        cout << "\niterating over " << bt.size() << " btree elements";
+        if (scans > 1)
+          cout << ' ' << scans << " times";
+        cout << "..." << endl;
         unsigned long count = 0;
         typename BT::key_type prior_key;
         t.start();
-        for (typename BT::const_iterator itr = bt.begin();
-          itr != bt.end();
-          ++itr)
+        for (long scan = 1; scan <= scans; ++scan)
         {
-          if (count && !key_compare(prior_key, itr->first))
-            throw std::runtime_error("btree iteration sequence error");
-          ++count;
-          prior_key = itr->first;
+          count = 0;
+          for (typename BT::const_iterator itr = bt.begin();
+            itr != bt.end();
+            ++itr)
+          {
+            if (count && !key_compare(prior_key, itr->first))
+              throw std::runtime_error("btree iteration sequence error");
+            ++count;
+            prior_key = itr->first;
+          }
         }
         iterate_tm = t.stop();
         cout << "  iteration complete" << endl;
         t.report();
+        if (scans > 1)
+          cout << "  " << (count * scans) / (iterate_tm.wall / sec)
+               << " elements per sec" << endl;
         if (count != bt.size())
           throw std::runtime_error("btree iteration count error");
       }
@@ -205,6 +357,9 @@ namespace
         t.report();
       }
 
+      if (find_threads)
+        concurrent_find_test(static_cast<const BT&>(bt), rng, key);
+
 //      if (verbose)
 //      {
 //        bt.flush();
@@ -284,18 +439,25 @@ namespace
       //       << ((insert_tm.system + insert_tm.user) * 1.0)
       //          / (this_tm.system + this_tm.user) << '\n';
 
-      cout << "\niterating over " << stl.size() << " stl elements..." << endl;
+      cout << "\niterating over " << stl.size() << " stl elements";
+      if (scans > 1)
+        cout << ' ' << scans << " times";
+      cout << "..." << endl;
       unsigned long count = 0;
       typename BT::key_type prior_key;
       t.start();
-      for (typename stl_type::const_iterator itr = stl.begin();
-        itr != stl.end();
-        ++itr)
+      for (long scan = 1; scan <= scans; ++scan)
       {
-        if (count && !key_compare(prior_key, itr->first))
-          throw std::runtime_error("stl iteration sequence error");
-        ++count;
-        prior_key = itr->first;
+        count = 0;
+        for (typename stl_type::const_iterator itr = stl.begin();
+          itr != stl.end();
+          ++itr)
+        {
+          if (count && !key_compare(prior_key, itr->first))
+            throw std::runtime_error("stl iteration sequence error");
+          ++count;
+          prior_key = itr->first;
+        }
       }
       this_tm = t.stop();
       cout << "  iteration complete" << endl;
@@ -456,8 +618,16 @@ int cpp_main(int argc, char * argv[])
       initial_n = atol( argv[2]+2 );
     else if ( *(argv[2]+1) == 'l' )
       lg = atol( argv[2]+2 );
+    else if ( *(argv[2]+1) == 'w' )
+      scans = atol( argv[2]+2 );
+    else if ( *(argv[2]+1) == 't' )
+      find_threads = atoi( argv[2]+2 );
     else if ( *(argv[2]+1) == 'k' )
       do_pack = true;
+    else if ( *(argv[2]+1) == 'b' )
+      do_bulk = true;
+    else if ( *(argv[2]+1) == 'c' )
+      churn_rounds = atol( argv[2]+2 );
     else if ( *(argv[2]+1) == 'r' )
       do_preload = true;
     else if ( *(argv[2]+1) == 'v' )
@@ -483,9 +653,15 @@ int cpp_main(int argc, char * argv[])
       "   -xc      No create; use file from prior -xe run\n"
       "   -xi      No insert test; forces -xc and doesn't do inserts\n"
       "   -xf      No find test\n"
+      "   -t#      Also find from 1, 2, 4, ... up to # threads at once\n"
       "   -xw      No iterate test\n"
+      "   -w#      Iterate (i.e. full scan) # times; default 1\n"
       "   -xe      No erase test; use to save file intact\n"
       "   -k       Pack tree after insert test\n"
+      "   -b       Also time inserting, then bulk loading, the elements in order,\n"
+      "              and copying the tree\n"
+      "   -c#      Also run # rounds of erase churn, reporting bytes per element,\n"
+      "              with and without rebalancing on erase, then compact\n"
       "   -v       Verbose output statistics\n"
       "   -stl     Also run the tests against std::map\n"
       "   -rx      Report ratio as stl/btree instead of btree/stl\n"
@@ -0,0 +1,152 @@
+//  concurrent_test.cpp  ---------------------------------------------------------------//
+
+//  Copyright Beman Dawes 2010, 2011
+
+//  Distributed under the Boost Software License, Version 1.0.
+//  http://www.boost.org/LICENSE_1_0.txt
+
+//  This library is experimental and has not been accepted as a boost.org library
+
+#include <boost/config/warning_disable.hpp>
+#include <boost/config.hpp>
+
+#include <iostream>
+#include <boost/detail/lightweight_test.hpp>
+#include <boost/btree/concurrent_mbt_map.hpp>
+#include <map>
+#include <vector>
+#include <thread>
+#include <atomic>
+
+#include <boost/test/included/prg_exec_monitor.hpp>
+
+using namespace boost;
+using std::cout; using std::endl;
+
+namespace
+{
+  typedef btree::concurrent_mbt_map<int, long> map;
+
+  const int node_sz = 64;       // small nodes so that splits happen early and often
+  const int n_threads = 4;
+  const int n_per_thread = 5000;
+
+  void single_thread_test()
+  {
+    cout << "single thread test" << endl;
+
+    map bt(node_sz);
+    std::map<int, long> stl;
+    BOOST_TEST(bt.empty());
+    BOOST_TEST_EQ(bt.height(), 0);
+
+    for (int i = 0; i < 1000; ++i)
+    {
+      int k = (i * 7919) % 1000;  // 7919 is prime, so each k occurs once
+      BOOST_TEST(bt.insert(map::value_type(k, k*10)));
+      stl.insert(std::pair<const int, long>(k, k*10));
+    }
+    BOOST_TEST_EQ(bt.size(), stl.size());
+    BOOST_TEST(bt.height() > 1);
+    BOOST_TEST(!bt.insert(map::value_type(5, 0)));  // duplicate
+
+    long mv = 0;
+    for (int i = -1; i <= 1000; ++i)
+    {
+      bool found = bt.find(i, mv);
+      BOOST_TEST_EQ(found, stl.count(i) == 1);
+      if (found)
+        BOOST_TEST_EQ(mv, i*10L);
+      BOOST_TEST_EQ(bt.count(i), stl.count(i));
+    }
+
+    BOOST_TEST(!bt.insert_or_assign(5, 123));
+    BOOST_TEST(bt.find(5, mv));
+    BOOST_TEST_EQ(mv, 123);
+    BOOST_TEST(bt.insert_or_assign(1000, 7));
+    BOOST_TEST_EQ(bt[1000], 7);
+    BOOST_TEST_EQ(bt[1001], 0);  // inserts
+    BOOST_TEST_EQ(bt.size(), 1002U);
+
+    for (int i = 0; i < 1002; i += 2)
+      BOOST_TEST_EQ(bt.erase(i), 1U);
+    BOOST_TEST_EQ(bt.erase(0), 0U);
+    BOOST_TEST_EQ(bt.size(), 501U);
+    for (int i = 0; i < 1002; ++i)
+      BOOST_TEST_EQ(bt.count(i), i % 2 ? 1U : 0U);
+  }
+
+  void multi_thread_test()
+  {
+    cout << "multi thread test" << endl;
+
+    map bt(node_sz);
+    std::atomic<bool> done(false);
+    std::atomic<long> bad_values(0);
+
+    // readers run throughout; any value they find must be the one inserted
+    std::vector<std::thread> readers;
+    for (int t = 0; t < 2; ++t)
+      readers.push_back(std::thread([&bt, &done, &bad_values]()
+      {
+        while (!done.load())
+          for (int k = 0; k < n_threads * n_per_thread; k += 17)
+          {
+            long mv;
+            if (bt.find(k, mv) && mv != k)
+              ++bad_values;
+          }
+      }));
+
+    // writers insert interleaved keys, so they contend for the same leaves
+    std::vector<std::thread> writers;
+    for (int t = 0; t < n_threads; ++t)
+      writers.push_back(std::thread([&bt, t]()
+      {
+        for (int i = 0; i < n_per_thread; ++i)
+          bt.insert(map::value_type(i * n_threads + t, i * n_threads + t));
+      }));
+    for (std::size_t t = 0; t < writers.size(); ++t)
+      writers[t].join();
+
+    BOOST_TEST_EQ(bt.size(), std::size_t(n_threads * n_per_thread));
+    for (int k = 0; k < n_threads * n_per_thread; ++k)
+      BOOST_TEST_EQ(bt.count(k), 1U);
+
+    // concurrent erase of odd keys and reassignment of even keys
+    writers.clear();
+    for (int t = 0; t < n_threads; ++t)
+      writers.push_back(std::thread([&bt, t]()
+      {
+        for (int k = t; k < n_threads * n_per_thread; k += n_threads)
+        {
+          if (k % 2)
+            bt.erase(k);
+          else
+            bt.insert_or_assign(k, k);
+        }
+      }));
+    for (std::size_t t = 0; t < writers.size(); ++t)
+      writers[t].join();
+
+    done = true;
+    for (std::size_t t = 0; t < readers.size(); ++t)
+      readers[t].join();
+
+    BOOST_TEST_EQ(bad_values.load(), 0);
+    BOOST_TEST_EQ(bt.size(), std::size_t(n_threads * n_per_thread / 2));
+    for (int k = 0; k < n_threads * n_per_thread; ++k)
+      BOOST_TEST_EQ(bt.count(k), k % 2 ? 0U : 1U);
+  }
+
+} // unnamed namespace
+
+//------------------------------------ cpp_main() -------------------------------------//
+
+int cpp_main(int, char*[])
+{
+  single_thread_test();
+  multi_thread_test();
+
+  return report_errors();
+}
@@ -0,0 +1,313 @@
+//  concurrent_time.cpp  ---------------------------------------------------------------//
+
+//  Copyright Beman Dawes 2010, 2011
+
+//  Distributed under the Boost Software License, Version 1.0.
+//  http://www.boost.org/LICENSE_1_0.txt
+
+//  This library is experimental and has not been accepted as a boost.org library
+
+//  YCSB style driver: after loading n records, runs read/update mixes from 1, 2, 4,
+//  ... threads against concurrent_mbt_map, and against an mbt_map guarded by a single
+//  mutex for comparison.
+//
+//    workload a: 50% reads, 50% updates
+//    workload b: 95% reads,  5% updates
+//    workload c: 100% reads
+
+#define BOOST_NO_CONSTEXPR
+
+#include <boost/btree/concurrent_mbt_map.hpp>
+#include <boost/btree/mbt_map.hpp>
+#include <boost/random.hpp>
+#include <boost/btree/support/timer.hpp>
+
+#include <iostream>
+#include <string>
+#include <cstring>
+#include <cstdlib>  // for atol()
+#include <cmath>
+#include <vector>
+#include <thread>
+#include <mutex>
+
+#include <boost/test/included/prg_exec_monitor.hpp>
+
+using namespace boost;
+using std::cout;
+using std::endl;
+
+namespace
+{
+  std::string command_args;
+  long n;
+  long ops = 0;
+  long seed = 1;
+  int max_threads = 4;
+  int node_sz = boost::btree::default_node_size;
+  std::string workloads("abc");
+  bool zipfian (true);
+  bool do_locked (true);
+
+  typedef boost::int64_t key_type;
+  typedef boost::int64_t mapped_type;
+
+  const long double sec = 1000000.0L;
+
+  //  A request is a key, and whether it is an update; requests are generated before
+  //  timing starts so that the random number generators are not measured
+
+  struct request
+  {
+    key_type  key;
+    bool      update;
+  };
+
+  //------------------------------  zipfian_generator  ---------------------------------//
+
+  //  Zipfian distribution over [0, items) with constant 0.99, as in YCSB (after Gray
+  //  et al, "Quickly Generating Billion-Record Synthetic Databases"). Popular items are
+  //  scattered over the key space by hashing, as in YCSB's ScrambledZipfianGenerator.
+
+  class zipfian_generator
+  {
+  public:
+    zipfian_generator(long items)
+      : m_items(items), m_theta(0.99)
+    {
+      m_zetan = 0.0;
+      for (long i = 1; i <= items; ++i)
+        m_zetan += 1.0 / std::pow(double(i), m_theta);
+      double zeta2 = 1.0 + 1.0 / std::pow(2.0, m_theta);
+      m_alpha = 1.0 / (1.0 - m_theta);
+      m_eta = (1.0 - std::pow(2.0 / items, 1.0 - m_theta)) / (1.0 - zeta2 / m_zetan);
+    }
+
+    template <class RNG>
+    key_type operator()(RNG& rng)
+    {
+      double u = uniform_01<>()(rng);
+      double uz = u * m_zetan;
+      long rank;
+      if (uz < 1.0)
+        rank = 0;
+      else if (uz < 1.0 + std::pow(0.5, m_theta))
+        rank = 1;
+      else
+        rank = long(m_items * std::pow(m_eta * u - m_eta + 1.0, m_alpha));
+      if (rank >= m_items)
+        rank = m_items - 1;
+      return scramble(rank) % m_items;
+    }
+
+    static boost::uint64_t scramble(boost::uint64_t x)  // FNV-1a, 64-bit
+    {
+      boost::uint64_t h = 0xCBF29CE484222325ULL;
+      for (int i = 0; i < 8; ++i, x >>= 8)
+      {
+        h ^= x & 0xff;
+        h *= 0x100000001B3ULL;
+      }
+      return h;
+    }
+
+  private:
+    long    m_items;
+    double  m_theta;
+    double  m_zetan;
+    double  m_alpha;
+    double  m_eta;
+  };
+
+  //--------------------------------  map adapters  ------------------------------------//
+
+  class olc_map
+  {
+  public:
+    olc_map() : m_map(node_sz) {}
+    static const char* name()  {return "concurrent_mbt_map";}
+    void load(key_type k, mapped_type mv)  {m_map.insert_or_assign(k, mv);}
+    bool read(key_type k, mapped_type& mv) const  {return m_map.find(k, mv);}
+    void update(key_type k, mapped_type mv)  {m_map.insert_or_assign(k, mv);}
+  private:
+    btree::concurrent_mbt_map<key_type, mapped_type> m_map;
+  };
+
+  class locked_map
+  {
+  public:
+    locked_map() : m_map(node_sz) {}
+    static const char* name()  {return "mbt_map + mutex";}
+    void load(key_type k, mapped_type mv)  {m_map[k] = mv;}
+    bool read(key_type k, mapped_type& mv) const
+    {
+      std::lock_guard<std::mutex> guard(m_mutex);
+      btree::mbt_map<key_type, mapped_type>::const_iterator it = m_map.find(k);
+      if (it == m_map.end())
+        return false;
+      mv = it->second;
+      return true;
+    }
+    void update(key_type k, mapped_type mv)
+    {
+      std::lock_guard<std::mutex> guard(m_mutex);
+      m_map[k] = mv;
+    }
+  private:
+    btree::mbt_map<key_type, mapped_type>  m_map;
+    mutable std::mutex                     m_mutex;
+  };
+
+  //------------------------------------ run() -----------------------------------------//
+
+  template <class Map>
+  void run(Map& m, const std::vector<request>& reqs, long& not_found)
+  {
+    for (std::vector<request>::const_iterator it = reqs.begin(); it != reqs.end(); ++it)
+    {
+      mapped_type mv;
+      if (it->update)
+        m.update(it->key, it->key);
+      else if (!m.read(it->key, mv))
+        ++not_found;
+    }
+  }
+
+  //------------------------------------ test() ----------------------------------------//
+
+  template <class Map>
+  void test(const std::vector<std::vector<request> >& reqs, char workload)
+  {
+    Map m;
+    for (long i = 0; i < n; ++i)
+      m.load(i, i);
+
+    btree::run_timer t(3);
+    for (int thread_ct = 1; thread_ct <= max_threads; thread_ct *= 2)
+    {
+      std::vector<std::thread> threads;
+      std::vector<long> not_found(thread_ct);
+      t.start();
+      for (int i = 0; i < thread_ct; ++i)
+        threads.push_back(std::thread(run<Map>, std::ref(m), std::cref(reqs[i]),
+          std::ref(not_found[i])));
+      for (int i = 0; i < thread_ct; ++i)
+        threads[i].join();
+      btree::times_t tm = t.stop();
+      for (int i = 0; i < thread_ct; ++i)
+        if (not_found[i])
+          throw std::runtime_error("read of a loaded record failed");
+
+      cout << "  workload " << workload << ", " << Map::name() << ", "
+           << thread_ct << " thread(s): ";
+      if (tm.wall)
+        cout << (ops * thread_ct) / (tm.wall / sec) << " ops per sec";
+      cout << endl;
+    }
+  }
+}
+
+//-------------------------------------- main()  ---------------------------------------//
+
+int cpp_main(int argc, char * argv[])
+{
+  for (int a = 0; a < argc; ++a)
+  {
+    command_args += argv[a];
+    if (a != argc-1)
+      command_args += ' ';
+  }
+
+  cout << command_args << '\n';;
+
+  if (argc >=2)
+    n = std::atol(argv[1]);
+
+  for (; argc > 2; ++argv, --argc)
+  {
+    if ( std::strncmp( argv[2]+1, "xl", 2 )==0 )
+      do_locked = false;
+    else if ( *(argv[2]+1) == 'u' )
+      zipfian = false;
+    else if ( *(argv[2]+1) == 'w' )
+      workloads = argv[2]+2;
+    else if ( *(argv[2]+1) == 'o' )
+      ops = atol( argv[2]+2 );
+    else if ( *(argv[2]+1) == 't' )
+      max_threads = atoi( argv[2]+2 );
+    else if ( *(argv[2]+1) == 's' )
+      seed = atol( argv[2]+2 );
+    else if ( *(argv[2]+1) == 'n' )
+      node_sz = atoi( argv[2]+2 );
+    else
+    {
+      cout << "Error - unknown option: " << argv[2] << "\n\n";
+      argc = -1;
+      break;
+    }
+  }
+
+  if (argc < 2 || n < 1)
+  {
+    cout << "Usage: concurrent_time n [Options]\n"
+      " The argument n specifies the number of records to load\n"
+      " Options:\n"
+      "   -o#      Operations per thread; default n\n"
+      "   -t#      Run from 1, 2, 4, ... up to # threads; default 4\n"
+      "   -w...    Workloads to run, from a, b, c; default abc\n"
+      "   -u       Uniform key distribution; default is zipfian\n"
+      "   -s#      Seed for random number generator; default 1\n"
+      "   -n#      Node size (>=128); default " << btree::default_node_size << "\n"
+      "   -xl      No mutex guarded mbt_map comparison\n"
+      ;
+    return 1;
+  }
+
+  if (!ops)
+    ops = n;
+
+  cout << "starting tests with node size " << node_sz << ", "
+       << (zipfian ? "zipfian" : "uniform") << " keys\n";
+  cout.setf(std::ios_base::fixed, std::ios_base::floatfield);
+  cout.precision(1);
+
+  zipfian_generator zipf(n);
+  uniform_int<key_type> uniform(0, n-1);
+
+  for (std::string::size_type w = 0; w < workloads.size(); ++w)
+  {
+    char workload = workloads[w];
+    int update_pct = workload == 'a' ? 50 : workload == 'b' ? 5 : 0;
+    if (workload != 'a' && workload != 'b' && workload != 'c')
+    {
+      cout << "Error - unknown workload: " << workload << endl;
+      return 1;
+    }
+
+    cout << "\nworkload " << workload << ": " << 100 - update_pct << "% reads, "
+         << update_pct << "% updates" << endl;
+
+    // each thread gets its own request stream
+    rand48 rng;
+    rng.seed(seed);
+    uniform_int<int> pct(0, 99);
+    std::vector<std::vector<request> > reqs(max_threads);
+    for (int i = 0; i < max_threads; ++i)
+    {
+      reqs[i].reserve(ops);
+      for (long j = 0; j < ops; ++j)
+      {
+        request r;
+        r.key = zipfian ? zipf(rng) : uniform(rng);
+        r.update = pct(rng) < update_pct;
+        reqs[i].push_back(r);
+      }
+    }
+
+    test<olc_map>(reqs, workload);
+    if (do_locked)
+      test<locked_map>(reqs, workload);
+  }
+
+  return 0;
+}
@@ -23,7 +23,14 @@
 #include <set>
 #include <boost/type_traits.hpp>
 #include <boost/btree/detail/archetype.hpp>
+#include <boost/btree/support/history_tracker.hpp>
 #include <utility>
+#include <string>
+#include <vector>
+#include <iterator>
+#include <algorithm>
+#include <limits>
+#include <cstring>
 
 #include <boost/test/included/prg_exec_monitor.hpp>
 
@@ -141,6 +148,780 @@ namespace
   template <class BT>
   void operator_sq_bracket_test(BT& bt, false_type, false_type) {}
 
+  //------------------------------  allocator_test()  ----------------------------------//
+
+  long allocated_bytes = 0;
+  long allocations = 0;
+
+  template <class T>
+  class counting_allocator  // stateless, but counts the bytes allocated through it
+  {
+  public:
+    typedef T value_type;
+    counting_allocator() {}
+    template <class U> counting_allocator(const counting_allocator<U>&) {}
+    T* allocate(std::size_t n)
+    {
+      allocated_bytes += n * sizeof(T);
+      ++allocations;
+      return static_cast<T*>(::operator new(n * sizeof(T)));
+    }
+    void deallocate(T* p, std::size_t n)
+    {
+      allocated_bytes -= n * sizeof(T);
+      ::operator delete(p);
+    }
+  };
+  template <class T, class U>
+  bool operator==(const counting_allocator<T>&, const counting_allocator<U>&) {return true;}
+  template <class T, class U>
+  bool operator!=(const counting_allocator<T>&, const counting_allocator<U>&) {return false;}
+
+#ifdef BOOST_BTREE_HAS_PMR
+  class counting_resource : public std::pmr::memory_resource
+  {
+  public:
+    long bytes;
+    counting_resource() : bytes(0) {}
+  private:
+    void* do_allocate(std::size_t n, std::size_t align)
+    {
+      bytes += n;
+      return std::pmr::new_delete_resource()->allocate(n, align);
+    }
+    void do_deallocate(void* p, std::size_t n, std::size_t align)
+    {
+      bytes -= n;
+      std::pmr::new_delete_resource()->deallocate(p, n, align);
+    }
+    bool do_is_equal(const std::pmr::memory_resource& x) const noexcept
+    {
+      return this == &x;
+    }
+  };
+#endif
+
+  void allocator_test()
+  {
+    cout << "allocator test" << endl;
+
+    {
+      typedef btree::mbt_map<int, long, std::less<int>,
+        counting_allocator<std::pair<const int, long> > > map;
+      map bt(128);
+      BOOST_TEST(allocated_bytes >= 128);  // the root
+      for (int i = 0; i < 1000; ++i)
+        bt[i] = i;
+      long inserted_bytes = allocated_bytes;
+      BOOST_TEST(inserted_bytes >= 1000L * 16);
+      BOOST_TEST(allocations < 10);  // nodes come from a few slabs
+      map bt2(bt);
+      BOOST_TEST(allocated_bytes <= 2 * inserted_bytes);  // same shape, same nodes
+      for (int i = 0; i < 1000; i += 2)
+        bt.erase(i);
+      bt2 = bt;
+
+      // freed nodes are reused, so churn allocates nothing further
+      long churn_allocations = allocations;
+      long churn_bytes = allocated_bytes;
+      for (int j = 0; j < 10; ++j)
+      {
+        for (int i = 0; i < 1000; i += 2)
+          bt.insert(map::value_type(i, i));
+        for (int i = 0; i < 1000; i += 2)
+          bt.erase(i);
+      }
+      BOOST_TEST_EQ(allocations, churn_allocations);
+      BOOST_TEST_EQ(allocated_bytes, churn_bytes);
+
+      // shrinking returns the storage of erased elements' nodes to the allocator
+      for (int i = 1; i < 1000; i += 4)
+        bt.erase(i);
+      std::size_t released = bt.shrink_to_fit();
+      BOOST_TEST(released > 0);
+      BOOST_TEST_EQ(allocated_bytes, churn_bytes - long(released));
+      BOOST_TEST_EQ(bt.size(), 250U);
+      bt.clear();
+    }
+    BOOST_TEST_EQ(allocated_bytes, 0);
+
+#ifdef BOOST_BTREE_HAS_PMR
+    cout << "std::pmr test" << endl;
+
+    counting_resource res;
+    {
+      btree::pmr::mbt_set<int> bt(128, std::less<int>(), &res);
+      for (int i = 0; i < 1000; ++i)
+        bt.insert(i);
+      BOOST_TEST(res.bytes >= 1000L * 4);
+      long inserted_bytes = res.bytes;
+
+      btree::pmr::mbt_set<int> bt2(bt);  // like std::pmr containers, uses the default
+      BOOST_TEST(bt2 == bt);
+      BOOST_TEST(bt2.get_allocator().resource() == std::pmr::get_default_resource());
+      BOOST_TEST_EQ(res.bytes, inserted_bytes);
+
+      btree::pmr::mbt_set<int> bt3(std::move(bt));  // keeps the resource
+      BOOST_TEST(bt3.get_allocator().resource() == &res);
+      BOOST_TEST_EQ(bt3.size(), 1000U);
+    }
+    BOOST_TEST_EQ(res.bytes, 0);
+
+    {
+      std::pmr::monotonic_buffer_resource mono;
+      btree::pmr::mbt_map<int, long> bt(btree::default_node_size, std::less<int>(), &mono);
+      for (int i = 0; i < 10000; ++i)
+        bt[i] = i;
+      BOOST_TEST_EQ(bt.size(), 10000U);
+      BOOST_TEST_EQ(bt.find(5000)->second, 5000);
+    }
+#endif
+  }
+
+  //------------------------------  split_move_test()  ---------------------------------//
+
+  struct Int
+  {
+    int value;
+
+    Int() : value(-1) {}
+    Int(int v) : value(v) {}
+  };
+  bool operator<(const Int& x, const Int& y) {return x.value < y.value;}
+  typedef btree::history_tracker<Int> tracked;
+
+  int moves(const tracked& x) {return x.move_construction() + x.move_assignment();}
+
+  void split_move_test()
+  {
+    cout << "split move test" << endl;
+
+    typedef btree::mbt_set<tracked> set;
+    set bt(256);
+    const int leaf_size = int(bt.node_size() / sizeof(tracked));
+    for (int i = 0; i < 2 * leaf_size; ++i)
+      bt.insert(tracked(10 * i));  // ascending, so both leaves are full
+    for (set::iterator it = bt.begin(); it != bt.end(); ++it)
+      BOOST_TEST_EQ(moves(*it), 1);  // from the argument into the leaf
+
+    // the insert point falls on the new leaf, so the split moves the elements
+    // following it only once
+    bt.insert(tracked(10 * (leaf_size - 1) - 5));
+    int split_moves = 0;
+    for (set::iterator it = bt.begin(); it != bt.end(); ++it)
+    {
+      BOOST_TEST(moves(*it) <= 2);
+      BOOST_TEST_EQ(it->default_construction(), 0);
+      BOOST_TEST_EQ(it->copy_construction() + it->copy_assignment(), 0);
+      split_moves += moves(*it) - 1;
+    }
+    BOOST_TEST_EQ(split_moves, leaf_size / 2);
+
+    // no insert, splitting leaves and branches or not, moves an element more than once
+    set bt2(256);
+    std::vector<int> prior(1000);
+    for (int i = 1; i <= 1000; ++i)
+    {
+      int k = (i * 7919) % 1000;  // 7919 is prime, so each k occurs once
+      bt2.insert(tracked(k));
+      for (set::iterator it = bt2.begin(); it != bt2.end(); ++it)
+      {
+        if (it->value != k)
+          BOOST_TEST(moves(*it) - prior[it->value] <= 1);
+        prior[it->value] = moves(*it);
+      }
+    }
+    BOOST_TEST(bt2.height() > 1);
+  }
+
+  //------------------------------  simd_search_test()  --------------------------------//
+
+#ifdef BOOST_BTREE_SIMD_SEARCH
+  template <class Key, class Compare>
+  void simd_search_test(boost::detail::simd_level level)
+  {
+    typedef std::numeric_limits<Key> limits;
+    Key probes[] = {limits::min(), Key(limits::min()+1), Key(limits::min()/2), Key(-1),
+      Key(0), Key(1), Key(2), Key(limits::max()/2), Key(limits::max()-1), limits::max()};
+    const std::size_t n_probes = sizeof(probes) / sizeof(Key);
+
+    // keys are stride bytes apart, following other bytes, as in a node
+    for (std::size_t stride = sizeof(Key); stride <= 3*sizeof(Key); stride += 2*sizeof(Key))
+      for (std::size_t n = 0; n <= 70; ++n)
+      {
+        std::vector<Key> keys;
+        for (std::size_t i = 0; i < n; ++i)
+          keys.push_back(probes[(i * 7) % n_probes]);  // with duplicates
+        std::sort(keys.begin(), keys.end(), Compare());
+        std::vector<char> buf(8 + n * stride);
+        for (std::size_t i = 0; i < n; ++i)
+          std::memcpy(&buf[8 + i * stride], &keys[i], sizeof(Key));
+
+        for (std::size_t i = 0; i < n_probes; ++i)
+        {
+          std::size_t low = std::lower_bound(keys.begin(), keys.end(), probes[i],
+            Compare()) - keys.begin();
+          std::size_t up = std::upper_bound(keys.begin(), keys.end(), probes[i],
+            Compare()) - keys.begin();
+          BOOST_TEST_EQ((boost::detail::simd_bound<Key, Compare>(&buf[8], n, stride,
+            probes[i], false, level)), low);
+          BOOST_TEST_EQ((boost::detail::simd_bound<Key, Compare>(&buf[8], n, stride,
+            probes[i], true, level)), up);
+        }
+      }
+  }
+
+  template <class Key>
+  void simd_search_test(boost::detail::simd_level level)
+  {
+    simd_search_test<Key, std::less<Key> >(level);
+    simd_search_test<Key, std::greater<Key> >(level);
+  }
+#endif
+
+  void simd_search_test()
+  {
+    cout << "simd search test" << endl;
+
+#ifdef BOOST_BTREE_SIMD_SEARCH
+    using boost::detail::simd_level;
+    for (int level = boost::detail::simd_sse42; level <= boost::detail::simd_support();
+      ++level)
+    {
+      cout << "  " << (level == boost::detail::simd_avx2 ? "avx2" : "sse4.2") << endl;
+      simd_search_test<signed char>(simd_level(level));
+      simd_search_test<unsigned char>(simd_level(level));
+      simd_search_test<boost::int16_t>(simd_level(level));
+      simd_search_test<boost::uint16_t>(simd_level(level));
+      simd_search_test<boost::int32_t>(simd_level(level));
+      simd_search_test<boost::uint32_t>(simd_level(level));
+      simd_search_test<boost::int64_t>(simd_level(level));
+      simd_search_test<boost::uint64_t>(simd_level(level));
+    }
+#endif
+
+    // whichever search is used, containers must agree with std::set
+    btree::mbt_set<boost::uint64_t, std::greater<boost::uint64_t> > bt(256);
+    std::set<boost::uint64_t, std::greater<boost::uint64_t> > stl;
+    for (boost::uint64_t i = 1; i <= 3000; ++i)
+    {
+      boost::uint64_t k = (i * 7919) % 3000 * 0x0001000100010001ULL;
+      bt.insert(k);
+      stl.insert(k);
+    }
+    BOOST_TEST(bt.height() > 1);
+    for (boost::uint64_t i = 0; i <= 3001; ++i)
+    {
+      boost::uint64_t k = i * 0x0001000100010001ULL - 1;
+      BOOST_TEST(*bt.lower_bound(k) == *stl.lower_bound(k));
+      BOOST_TEST_EQ(bt.count(k + 1), stl.count(k + 1));
+    }
+  }
+
+  //-----------------------------  branch_layout_test()  -------------------------------//
+
+  //  Branches place child pointers after room for their keys, so keys narrower than
+  //  a pointer, and keys more strictly aligned than one, exercise the layout
+
+  struct wide_key
+  {
+    alignas(16) long value;
+    wide_key(long v = 0) : value(v) {}
+    bool operator<(const wide_key& rhs) const {return value < rhs.value;}
+    bool operator==(const wide_key& rhs) const {return value == rhs.value;}
+  };
+
+  template <class Key>
+  void branch_layout_test(Key (*make)(int))
+  {
+    btree::mbt_multiset<Key> bt(128);
+    std::multiset<Key> stl;
+    for (int i = 1; i <= 3000; ++i)
+    {
+      Key k = make((i * 7919) % 1000);  // each key occurs 3 times
+      bt.insert(k);
+      stl.insert(k);
+    }
+    BOOST_TEST(bt.height() > 1);
+    BOOST_TEST(std::equal(bt.begin(), bt.end(), stl.begin()));
+    btree::mbt_multiset<Key> copy(bt);
+    BOOST_TEST(std::equal(copy.begin(), copy.end(), stl.begin()));
+
+    for (int i = 1; i <= 1000; ++i)
+    {
+      Key k = make((i * 7919) % 1000);
+      if (i % 3)
+        BOOST_TEST_EQ(bt.erase(k), stl.erase(k));
+      BOOST_TEST_EQ(bt.count(k), stl.count(k));
+    }
+    BOOST_TEST_EQ(bt.size(), stl.size());
+    BOOST_TEST(std::equal(bt.begin(), bt.end(), stl.begin()));
+  }
+
+  char make_char(int i)  {return char(i % 128);}
+  wide_key make_wide_key(int i)  {return wide_key(i);}
+  std::string make_string(int i)  {return std::to_string(i);}
+
+  void branch_layout_test()
+  {
+    cout << "branch layout test" << endl;
+    branch_layout_test(make_char);
+    branch_layout_test(make_wide_key);
+    branch_layout_test(make_string);
+  }
+
+  //-----------------------------  search_policy_test()  -------------------------------//
+
+  double make_double(int i)  {return i / 4.0;}
+  long make_long(int i)  {return i;}
+
+  void node_search_test()
+  {
+    // both kernels against std::lower_bound and std::upper_bound, duplicates included
+    for (std::size_t n = 0; n <= 70; ++n)
+    {
+      std::vector<double> keys;
+      for (std::size_t i = 0; i < n; ++i)
+        keys.push_back(double(i / 3));
+      std::vector<double> eytz(n + 1);
+      std::vector<boost::uint16_t> ranks(n + 1);
+      BOOST_TEST_EQ(boost::detail::eytzinger_fill(keys.data(), n, eytz.data(),
+        ranks.data()), n);
+
+      for (double k = -1.0; k <= n / 3 + 1; k += 0.5)
+      {
+        std::size_t low = std::lower_bound(keys.begin(), keys.end(), k) - keys.begin();
+        std::size_t up = std::upper_bound(keys.begin(), keys.end(), k) - keys.begin();
+        std::less<double> comp;
+        BOOST_TEST_EQ(std::size_t(boost::detail::branchless_bound(keys.data(), n, k,
+          false, comp) - keys.data()), low);
+        BOOST_TEST_EQ(std::size_t(boost::detail::branchless_bound(keys.data(), n, k,
+          true, comp) - keys.data()), up);
+        BOOST_TEST_EQ(boost::detail::eytzinger_bound(eytz.data(), ranks.data(), n, k,
+          false, comp), low);
+        BOOST_TEST_EQ(boost::detail::eytzinger_bound(eytz.data(), ranks.data(), n, k,
+          true, comp), up);
+      }
+    }
+  }
+
+  template <class Search, class Key>
+  void search_policy_test(Key (*make)(int), std::size_t node_sz)
+  {
+    typedef btree::mbt_multiset<Key, std::less<Key>, std::allocator<Key>, Search> set;
+    typedef btree::mbt_map<Key, int, std::less<Key>,
+      std::allocator<std::pair<const Key, int> >, Search> map;
+    set bt(node_sz);
+    std::multiset<Key> stl;
+    map m(node_sz);
+    for (int i = 1; i <= 3000; ++i)
+    {
+      Key k = make((i * 7919) % 1000 * 2);  // each key occurs 3 times; odd keys absent
+      bt.insert(k);
+      stl.insert(k);
+      m[k] = i;
+    }
+    BOOST_TEST(bt.height() > 1);
+    BOOST_TEST(m.height() > 1);
+
+    for (int round = 0; round < 3; ++round)
+    {
+      set copy(bt);
+      for (int i = -1; i <= 2001; ++i)
+      {
+        Key k = make(i);
+        BOOST_TEST(bt.lower_bound(k) == bt.end() ? stl.lower_bound(k) == stl.end()
+          : *bt.lower_bound(k) == *stl.lower_bound(k));
+        BOOST_TEST(bt.upper_bound(k) == bt.end() ? stl.upper_bound(k) == stl.end()
+          : *bt.upper_bound(k) == *stl.upper_bound(k));
+        BOOST_TEST_EQ(bt.count(k), stl.count(k));
+        BOOST_TEST_EQ(copy.count(k), stl.count(k));
+        BOOST_TEST_EQ(m.count(k), stl.count(k) ? 1U : 0U);
+      }
+
+      // erasing rebalances branches; compacting rebuilds them
+      for (int i = round; i < 1000; i += 3)
+      {
+        Key k = make((i * 7919) % 1000 * 2);
+        BOOST_TEST_EQ(bt.erase(k), stl.erase(k));
+        m.erase(k);
+      }
+      if (round == 1)
+      {
+        bt.compact(0.5);
+        m.shrink_to_fit();
+      }
+    }
+    BOOST_TEST(bt.empty());
+    BOOST_TEST(m.empty());
+  }
+
+  template <class Search>
+  void search_policy_test()
+  {
+    search_policy_test<Search>(make_double, 128);
+    search_policy_test<Search>(make_double, 512);
+    search_policy_test<Search>(make_long, 128);
+    search_policy_test<Search>(make_wide_key, 256);
+  }
+
+  void search_policy_test()
+  {
+    cout << "search policy test" << endl;
+    node_search_test();
+    search_policy_test<btree::standard_search>();
+    search_policy_test<btree::branchless_search>();
+    search_policy_test<btree::eytzinger_search>();
+    search_policy_test<btree::standard_search>(make_string, 256);
+    search_policy_test<btree::branchless_search>(make_string, 256);
+  }
+
+  //---------------------------------  cursor_test()  ----------------------------------//
+
+  template <class BT>
+  void cursor_test(BT& bt)
+  {
+    typename BT::cursor cur(bt);
+    for (int k = -2; k < 6004; ++k)  // ascending, each seek next to the last
+      BOOST_TEST(cur.seek(k) == bt.lower_bound(k));
+    for (int k = 6003; k >= -2; k -= 3)  // descending
+      BOOST_TEST(cur.seek(k) == bt.lower_bound(k));
+    for (int i = 0; i < 6000; ++i)  // far apart
+    {
+      int k = (i * 4099) % 6005 - 2;
+      BOOST_TEST(cur.seek(k) == bt.lower_bound(k));
+    }
+  }
+
+  void cursor_test()
+  {
+    cout << "cursor test" << endl;
+
+    btree::mbt_map<int, long> bt(128);
+    btree::mbt_multiset<int> mbt(128);
+    btree::mbt_map<int, long, std::less<int>, std::allocator<std::pair<const int, long> >,
+      btree::eytzinger_search> ebt(512);
+    cursor_test(bt);  // empty tree
+    bt[4] = 4;
+    cursor_test(bt);  // root is a leaf
+
+    for (int i = 0; i < 3000; ++i)
+    {
+      bt[(i * 7919) % 3000 * 2] = i;  // even keys only
+      ebt[(i * 7919) % 3000 * 2] = i;
+      mbt.insert((i * 7919) % 1000 * 2);  // and each three times
+      mbt.insert((i * 7919) % 1000 * 2 + 4000);
+    }
+    BOOST_TEST(bt.height() > 1);
+    BOOST_TEST(ebt.height() > 1);
+    cursor_test(bt);
+    cursor_test(ebt);
+    cursor_test(mbt);
+
+    // after the container is modified, reset() makes the cursor usable again
+    btree::mbt_map<int, long>::cursor cur(bt);
+    BOOST_TEST(cur.seek(3000) == bt.find(3000));
+    for (int k = 0; k < 6000; k += 3)
+      bt.erase(k);
+    cur.reset();
+    BOOST_TEST(cur.seek(3000) == bt.lower_bound(3000));
+    BOOST_TEST(cur.seek(5998) == bt.find(5998));
+    BOOST_TEST(cur.seek(6000) == bt.end());
+  }
+
+  //---------------------------  order_statistics_test()  -----------------------------//
+
+  template <class BT>
+  void order_statistics_test(const BT& bt)
+  {
+    std::size_t i = 0;
+    for (typename BT::const_iterator it = bt.begin(); it != bt.end(); ++it, ++i)
+    {
+      BOOST_TEST(bt.select(i) == it);
+      BOOST_TEST_EQ(bt.index_of(it), i);
+    }
+    BOOST_TEST(bt.select(i) == bt.end());
+    BOOST_TEST_EQ(bt.index_of(bt.end()), bt.size());
+    for (int k = -1; k < 6002; ++k)
+    {
+      std::size_t n = std::distance(bt.begin(), bt.lower_bound(k));
+      BOOST_TEST_EQ(bt.rank(k), n);
+      n = std::distance(bt.lower_bound(k), bt.upper_bound(k));
+      BOOST_TEST_EQ(bt.count(k), n);
+    }
+  }
+
+  void order_statistics_test()
+  {
+    cout << "order statistics test" << endl;
+
+    typedef btree::mbt_map<int, long, std::less<int>,
+      std::allocator<std::pair<const int, long> >, btree::branchless_search,
+      btree::order_statistics> map_type;
+    typedef btree::mbt_multiset<int, std::less<int>, std::allocator<int>,
+      btree::eytzinger_search, btree::order_statistics> multiset_type;
+    map_type bt(128);
+    multiset_type mbt(256);
+    order_statistics_test(bt);  // empty tree
+
+    for (int i = 0; i < 3000; ++i)
+    {
+      bt[(i * 7919) % 3000 * 2] = i;  // even keys only
+      mbt.insert((i * 7919) % 1000 * 2);  // and each three times
+    }
+    for (int i = 0; i < 3000; ++i)
+      mbt.insert(mbt.end(), i + 2000);  // appended at the right edge
+    BOOST_TEST(bt.height() > 1);
+    order_statistics_test(bt);
+    order_statistics_test(mbt);
+
+    // erases, whether single, ranged, or merging and borrowing nodes, keep the counts
+    for (int k = 0; k < 6000; k += 3)
+      bt.erase(k);
+    bt.erase(bt.lower_bound(1000), bt.lower_bound(2500));
+    mbt.erase(mbt.select(100), mbt.select(4000));
+    mbt.erase(mbt.select(10));
+    order_statistics_test(bt);
+    order_statistics_test(mbt);
+
+    // as do copies and the bulk builders
+    map_type bt2(bt);
+    bt2.compact(0.5);
+    order_statistics_test(bt2);
+    multiset_type mbt2(256);
+    mbt2.bulk_load(mbt.begin(), mbt.end(), 0.7);
+    order_statistics_test(mbt2);
+    mbt2.shrink_to_fit();
+    order_statistics_test(mbt2);
+  }
+
+  //----------------------------  range_aggregate_test()  -----------------------------//
+
+  template <class BT>
+  void range_aggregate_test(const BT& bt, const std::map<boost::int64_t, double>& stl)
+  {
+    typename BT::monoid_type m;
+    for (boost::int64_t lo = -5; lo < 6010; lo += 97)
+      for (boost::int64_t hi = lo; hi < 6010; hi += 389)
+      {
+        double a = m.identity();
+        for (std::map<boost::int64_t, double>::const_iterator it = stl.lower_bound(lo);
+          it != stl.lower_bound(hi); ++it)
+          a = m.combine(a, it->second);
+        BOOST_TEST_EQ(bt.range_aggregate(lo, hi), a);
+      }
+    BOOST_TEST_EQ(bt.range_aggregate(bt.begin(), bt.end()), bt.aggregate());
+  }
+
+  void range_aggregate_test()
+  {
+    cout << "range aggregate test" << endl;
+
+    typedef std::allocator<std::pair<const boost::int64_t, double> > alloc;
+    typedef btree::mbt_map<boost::int64_t, double, std::less<boost::int64_t>, alloc,
+      btree::branchless_search,
+      btree::aggregate_statistics<btree::sum_aggregate<double> > > sum_map;
+    typedef btree::mbt_map<boost::int64_t, double, std::less<boost::int64_t>, alloc,
+      btree::branchless_search,
+      btree::aggregate_statistics<btree::max_aggregate<double> > > max_map;
+    sum_map sums(128);
+    max_map maxima(128);
+    std::map<boost::int64_t, double> stl;
+    range_aggregate_test(sums, stl);  // empty tree
+    BOOST_TEST_EQ(maxima.aggregate(), -std::numeric_limits<double>::infinity());
+
+    // values that sum exactly, so the order of additions doesn't matter
+    for (int i = 0; i < 3000; ++i)
+    {
+      boost::int64_t t = (i * 7919) % 3000 * 2;  // even times only
+      double v = (i * 31) % 101;
+      sums.insert(std::make_pair(t, v));
+      maxima.insert(std::make_pair(t, v));
+      stl.insert(std::make_pair(t, v));
+    }
+    BOOST_TEST(sums.height() > 1);
+    range_aggregate_test(sums, stl);
+    range_aggregate_test(maxima, stl);
+
+    for (boost::int64_t t = 0; t < 6000; t += 3)
+    {
+      sums.erase(t);
+      maxima.erase(t);
+      stl.erase(t);
+    }
+    sums.erase(sums.lower_bound(1000), sums.lower_bound(2000));
+    maxima.erase(maxima.lower_bound(1000), maxima.lower_bound(2000));
+    stl.erase(stl.lower_bound(1000), stl.lower_bound(2000));
+    range_aggregate_test(sums, stl);
+    range_aggregate_test(maxima, stl);
+
+    // a mapped value changed in place needs update_aggregates()
+    maxima.find(4000)->second = 500.0;
+    stl[4000] = 500.0;
+    maxima.update_aggregates(maxima.find(4000));
+    BOOST_TEST_EQ(maxima.aggregate(), 500.0);
+    range_aggregate_test(maxima, stl);
+
+    max_map copy(maxima);
+    copy.compact();
+    range_aggregate_test(copy, stl);
+  }
+
+  //-------------------------------  split_join_test()  -------------------------------//
+
+  template <class BT, class STL>
+  void split_join_test(const BT& bt, const STL& stl)
+  {
+    BOOST_TEST_EQ(bt.size(), stl.size());
+    BOOST_TEST(std::equal(bt.begin(), bt.end(), stl.begin()) );
+    BOOST_TEST(std::equal(bt.rbegin(), bt.rend(), stl.rbegin()) );
+    for (typename STL::const_iterator it = stl.begin(); it != stl.end(); ++it)
+      BOOST_TEST(bt.find(*it) != bt.end());
+  }
+
+  void split_join_test()
+  {
+    cout << "split and join test" << endl;
+
+    typedef btree::mbt_multiset<int, std::less<int>, std::allocator<int>,
+      btree::eytzinger_search, btree::order_statistics> counted_type;
+    btree::mbt_set<int> bt(128);
+    btree::mbt_set<int> tail(128);
+    std::set<int> stl;
+    for (int i = 0; i < 5000; ++i)
+    {
+      bt.insert((i * 7919) % 5000);
+      stl.insert(i);
+    }
+    BOOST_TEST(bt.height() > 2);
+
+    // a cut at each leaf position, between leaves, and at either end
+    int cuts[] = {2500, 1, 4999, 0, 5000, 1234, 3777};
+    for (std::size_t c = 0; c != sizeof(cuts) / sizeof(cuts[0]); ++c)
+    {
+      std::set<int> stl_tail(stl.lower_bound(cuts[c]), stl.end());
+      std::set<int> stl_head(stl.begin(), stl.lower_bound(cuts[c]));
+      bt.split_at(cuts[c], tail);
+      split_join_test(bt, stl_head);
+      split_join_test(tail, stl_tail);
+      bt.insert(-1);  // both stay usable
+      tail.insert(6000);
+      bt.erase(-1);
+      tail.erase(6000);
+      bt.join(tail);
+      BOOST_TEST(tail.empty());
+      split_join_test(bt, stl);
+      split_join_test(tail, std::set<int>());
+    }
+
+    // joining trees of different heights grafts the shorter onto the taller
+    btree::mbt_set<int> small(128);
+    for (int i = 5000; i < 5010; ++i)
+    {
+      small.insert(i);
+      stl.insert(i);
+    }
+    bt.join(small);
+    split_join_test(bt, stl);
+    small.insert(-10);
+    stl.insert(-10);
+    small.join(bt);
+    split_join_test(small, stl);
+    BOOST_TEST(bt.empty());
+
+    // the containers share storage after a split, so either may be destroyed first
+    {
+      btree::mbt_set<int> head(small);
+      btree::mbt_set<int>* rest = new btree::mbt_set<int>(128);
+      head.split_at(2000, *rest);
+      btree::mbt_set<int> rest2(128);
+      rest->split_at(4000, rest2);
+      delete rest;
+      for (int i = 0; i < 100; ++i)
+        rest2.erase(4000 + i);
+      BOOST_TEST_EQ(rest2.size(), 910U);
+      rest2.shrink_to_fit();
+      head.join(rest2);
+      BOOST_TEST_EQ(head.size(), 2001U + 910U);
+      head.compact();
+      BOOST_TEST_EQ(head.size(), 2911U);
+    }
+
+    // different node sizes can't exchange nodes, so elements are moved instead
+    btree::mbt_set<int> other(256);
+    small.split_at(2500, other);
+    BOOST_TEST_EQ(other.size(), 2510U);
+    small.join(other);
+    split_join_test(small, stl);
+
+    // counts follow the subtrees; equal keys all go to tail
+    counted_type mbt(128);
+    counted_type mtail(128);
+    std::multiset<int> mstl;
+    for (int i = 0; i < 3000; ++i)
+    {
+      mbt.insert((i * 7919) % 1000);
+      mstl.insert((i * 7919) % 1000);
+    }
+    mbt.split_at(500, mtail);
+    BOOST_TEST_EQ(mbt.size(), 1500U);
+    BOOST_TEST_EQ(mtail.size(), 1500U);
+    BOOST_TEST_EQ(mtail.count(500), 3U);
+    BOOST_TEST_EQ(mtail.rank(700), 600U);
+    BOOST_TEST(*mtail.select(0) == 500);
+    BOOST_TEST(*mbt.select(1499) == 499);
+    mbt.join(mtail);
+    split_join_test(mbt, mstl);
+    BOOST_TEST_EQ(mbt.rank(500), 1500U);
+    BOOST_TEST_EQ(mbt.index_of(mbt.find(999)), 2997U);
+  }
+
+  //-------------------------------  find_batch_test()  --------------------------------//
+
+  template <class BT>
+  void find_batch_test(const BT& bt, const std::vector<int>& keys)
+  {
+    std::vector<typename BT::const_iterator> found;
+    bt.find_batch(keys.begin(), keys.end(), std::back_inserter(found));
+    BOOST_TEST_EQ(found.size(), keys.size());
+    for (std::size_t i = 0; i != keys.size() && i != found.size(); ++i)
+      BOOST_TEST(found[i] == bt.find(keys[i]));
+  }
+
+  void find_batch_test()
+  {
+    cout << "find_batch test" << endl;
+
+    btree::mbt_map<int, long> bt(128);
+    btree::mbt_multiset<int> mbt(128);
+    std::vector<int> keys;
+    find_batch_test(bt, keys);
+    keys.push_back(1);
+    find_batch_test(bt, keys);  // empty tree
+
+    for (int i = 0; i < 3000; ++i)
+    {
+      bt[(i * 7919) % 3000 * 2] = i;  // even keys only
+      mbt.insert((i * 7919) % 1000 * 2);  // and each three times
+    }
+    BOOST_TEST(bt.height() > 1);
+
+    // present and absent keys, in no order, repeated, and not a multiple of the group
+    keys.clear();
+    for (int i = -3; i < 6010; ++i)
+      keys.push_back((i * 4099) % 6010);
+    find_batch_test(bt, keys);
+    find_batch_test(mbt, keys);
+    keys.resize(btree::find_batch_group + 1);
+    find_batch_test(bt, keys);
+    find_batch_test(mbt, keys);
+
+    btree::mbt_map<int, long>::iterator it;
+    int k = 2;
+    BOOST_TEST(bt.find_batch(&k, &k + 1, &it) == &it + 1);  // non-const
+    BOOST_TEST(it == bt.find(2));
+  }
+
   //----------------------------------- test() -----------------------------------------//
 
   template <class BT, class STL, class IsUnique, class IsMapped>
@@ -401,6 +1182,42 @@ namespace
     BOOST_TEST_EQ(bt.size(), bt5.size());
     BOOST_TEST(bt == bt5);
 
+    cout << "structural copy test" << endl;
+
+    BOOST_TEST_EQ(bt2.height(), bt.height());  // copy keeps the shape
+    BT bt5b(node_sz);
+    bt5b.insert(v1);
+    bt5b = bt;
+    BOOST_TEST(bt5b == bt);
+    BOOST_TEST_EQ(bt5b.height(), bt.height());
+    bt5b = bt5b;  // self assignment
+    BOOST_TEST(bt5b == bt);
+    bt5b.insert(BT::make_value(1000, 1000));  // copies must be independent
+    bt5b.erase(bt5b.begin());
+    BOOST_TEST_EQ(bt5b.size(), bt.size());
+    BOOST_TEST(bt5b != bt);
+
+    // large enough to clone subtrees of the root in parallel
+    std::vector<typename BT::value_type> big;
+    for (int i = 0; i < static_cast<int>(btree::parallel_clone_min_size) + 1000; ++i)
+      big.push_back(BT::make_value(i, i));
+    BT bt5c(big.begin(), big.end(), node_sz);
+    BT bt5d(bt5c);
+    BOOST_TEST_EQ(bt5d.size(), big.size());
+    BOOST_TEST(std::equal(bt5d.begin(), bt5d.end(), big.begin()));
+    itr = bt5d.end();
+    for (int i = static_cast<int>(big.size()) - 1; i >= 0; --i)
+      if (BT::key(*--itr) != i)
+      {
+        BOOST_TEST_EQ(BT::key(*itr), i);
+        break;
+      }
+    BOOST_TEST(itr == bt5d.begin());
+    bt5d.erase(0);
+    bt5d.insert(BT::make_value(-1, -1));
+    BOOST_TEST_EQ(BT::key(*bt5d.begin()), -1);
+    BOOST_TEST_EQ(BT::key(*bt5c.begin()), 0);
+
     cout << "move assignment test" << endl;
 
     BT bt6a(bt);
@@ -439,6 +1256,291 @@ namespace
     BOOST_TEST_EQ(bt.size(), 1U);
     BOOST_TEST_EQ(bt.height(), 0);
 
+    cout << "erase while iterating test" << endl;
+
+    BT bt8(node_sz);
+    for (int i = 1; i <= 100; ++i)
+      bt8.insert(BT::make_value(i, i));
+    BOOST_TEST(bt8.height() > 1);
+    // reaching elements via ++ does not create the child->parent list,
+    // so this exercises erase() of leaves found by sibling links
+    typename BT::iterator it8 = bt8.begin();
+    while (it8 != bt8.end())
+    {
+      it8 = bt8.erase(it8);
+      if (it8 != bt8.end())
+        ++it8;
+    }
+    BOOST_TEST_EQ(bt8.size(), 50U);
+    itr_checksum = 0;
+    for (itr = bt8.begin(); itr != bt8.end(); ++itr)
+      itr_checksum += BT::key(*itr);
+    BOOST_TEST_EQ(itr_checksum, 50*51);  // 2 + 4 + ... + 100
+    for (itr = bt8.end(); itr != bt8.begin();)
+      itr_checksum -= BT::key(*--itr);
+    BOOST_TEST_EQ(itr_checksum, 0);
+
+    cout << "bulk load test" << endl;
+
+    std::vector<typename BT::value_type> sorted;
+    for (int i = 1; i <= 200; ++i)
+    {
+      sorted.push_back(BT::make_value(i, i));
+      if (i % 10 == 0)
+        sorted.push_back(BT::make_value(i, i));  // duplicate
+    }
+    BT bt9(sorted.begin(), sorted.end(), node_sz);
+    STL stl9(sorted.begin(), sorted.end());
+    BOOST_TEST_EQ(bt9.size(), stl9.size());
+    BOOST_TEST(bt9.height() > 1);
+    BOOST_TEST(std::equal(bt9.begin(), bt9.end(), stl9.begin()));
+    itr_checksum = 0;
+    for (itr = bt9.end(); itr != bt9.begin();)
+      itr_checksum += BT::key(*--itr);
+    BOOST_TEST_EQ(itr_checksum, 200*201/2 + (IsUnique::value ? 0 : 10*20*21/2));
+    for (int i = 0; i <= 201; ++i)
+      BOOST_TEST_EQ(bt9.count(i), stl9.count(i));
+    // a bulk loaded tree must support ordinary modification
+    bt9.insert(BT::make_value(0, 0));
+    stl9.insert(BT::make_value(0, 0));
+    bt9.insert(BT::make_value(201, 201));
+    stl9.insert(BT::make_value(201, 201));
+    for (int i = 3; i <= 201; i += 3)
+    {
+      bt9.erase(i);
+      stl9.erase(i);
+    }
+    BOOST_TEST_EQ(bt9.size(), stl9.size());
+    BOOST_TEST(std::equal(bt9.begin(), bt9.end(), stl9.begin()));
+
+    BT bt10(node_sz);
+    bt10.bulk_load(sorted.begin(), sorted.end(), 0.5);  // half full nodes
+    STL stl10(sorted.begin(), sorted.end());
+    BOOST_TEST_EQ(bt10.size(), stl10.size());
+    BOOST_TEST(bt10.height() > bt9.height());
+    BOOST_TEST(std::equal(bt10.begin(), bt10.end(), stl10.begin()));
+
+    // elements that arrive out of order are inserted normally
+    std::vector<typename BT::value_type> mixed(sorted.begin(), sorted.begin() + 100);
+    for (int i = 200; i > 50; --i)
+      mixed.push_back(BT::make_value(i, i));
+    BT bt11(mixed.begin(), mixed.end(), node_sz);
+    STL stl11(mixed.begin(), mixed.end());
+    BOOST_TEST_EQ(bt11.size(), stl11.size());
+    BOOST_TEST(std::equal(bt11.begin(), bt11.end(), stl11.begin()));
+
+    cout << "erase rebalance test" << endl;
+
+    BT bt12(256);  // large enough that a quarter of a node is several elements
+    BT bt13(256);
+    bt13.min_fill(0.0);  // nodes are only removed once empty
+    STL stl12;
+    for (int i = 1; i <= 2000; ++i)
+    {
+      int k = (i * 7919) % 2000;  // 7919 is prime, so each k occurs once
+      bt12.insert(BT::make_value(k, k));
+      bt13.insert(BT::make_value(k, k));
+      stl12.insert(BT::make_value(k, k));
+      if (k % 10 == 0)
+      {
+        bt12.insert(BT::make_value(k, k));  // duplicate
+        stl12.insert(BT::make_value(k, k));
+      }
+    }
+    std::size_t full_nodes = bt12.node_count();
+    for (int k = 0; k < 2000; ++k)
+    {
+      if (k % 50 == 0)
+        continue;
+      BOOST_TEST_EQ(bt12.erase(k), stl12.erase(k));
+      bt13.erase(k);
+    }
+    BOOST_TEST_EQ(bt12.size(), stl12.size());
+    BOOST_TEST(std::equal(bt12.begin(), bt12.end(), stl12.begin()));
+    itr_checksum = 0;
+    for (itr = bt12.end(); itr != bt12.begin();)
+      itr_checksum += BT::key(*--itr);
+    BOOST_TEST_EQ(itr_checksum, 50*39*40/2 + (IsUnique::value ? 0 : 50*39*40/2));
+    for (int k = -1; k <= 2000; ++k)
+      BOOST_TEST_EQ(bt12.count(k), stl12.count(k));
+    BOOST_TEST(bt12.node_count() < bt13.node_count());
+    BOOST_TEST(bt12.node_count() * 10 < full_nodes);
+    BOOST_TEST(bt12.height() < bt13.height());
+
+    cout << "compact test" << endl;
+
+    std::size_t sparse_nodes = bt13.node_count();
+    int sparse_height = bt13.height();
+    bt13.compact();
+    BOOST_TEST(bt13.node_count() < sparse_nodes);
+    BOOST_TEST(bt13.height() < sparse_height);
+    BOOST_TEST_EQ(bt13.size(), IsUnique::value ? stl12.size() : stl12.size() / 2);
+    for (int k = -1; k <= 2000; ++k)
+      BOOST_TEST_EQ(bt13.count(k), k >= 0 && k < 2000 && k % 50 == 0 ? 1U : 0U);
+    itr_checksum = 0;
+    for (itr = bt13.end(); itr != bt13.begin();)
+      itr_checksum += BT::key(*--itr);
+    BOOST_TEST_EQ(itr_checksum, 50*39*40/2);
+    std::size_t packed_nodes = bt13.node_count();
+    bt13.compact(0.5);  // packs no further
+    BOOST_TEST_EQ(bt13.node_count(), packed_nodes);
+    bt13.shrink_to_fit();
+    BOOST_TEST_EQ(bt13.shrink_to_fit(), 0U);  // nothing more to release
+    BOOST_TEST_EQ(bt13.node_count(), packed_nodes);
+    BOOST_TEST_EQ(bt13.size(), IsUnique::value ? stl12.size() : stl12.size() / 2);
+    // a compacted tree must support ordinary modification
+    for (int k = 0; k < 2000; ++k)
+      bt13.insert(BT::make_value(k, k));
+    BOOST_TEST_EQ(bt13.size(), IsUnique::value ? 2000U : 2040U);
+    for (int k = 0; k < 2000; k += 2)
+      bt13.erase(k);
+    for (int k = -1; k <= 2000; ++k)
+      BOOST_TEST_EQ(bt13.count(k), k < 0 || k % 2 == 0 || k == 2000 ? 0U : 1U);
+
+    // erase() returns the element following the erased one, even if a borrow or merge
+    // moved it
+    for (int i = 0; i < 1000; ++i)
+      bt12.insert(BT::make_value(i, i));
+    std::size_t sz12 = bt12.size();
+    for (itr = bt12.begin(); itr != bt12.end();)
+    {
+      typename BT::key_type k = BT::key(*itr);
+      typename BT::iterator nxt = itr;
+      ++nxt;
+      bool last = nxt == bt12.end();
+      typename BT::key_type nxt_k = last ? k : BT::key(*nxt);
+      itr = bt12.erase(itr);
+      BOOST_TEST(last ? itr == bt12.end() : BT::key(*itr) == nxt_k);
+      if (itr != bt12.end())
+        ++itr;  // erase every other element
+    }
+    BOOST_TEST_EQ(bt12.size(), sz12 / 2);
+
+    // erasing a range may move elements the end of the range is on
+    bt12.erase(bt12.lower_bound(100), bt12.lower_bound(1900));
+    for (itr = bt12.begin(); itr != bt12.end(); ++itr)
+      BOOST_TEST(BT::key(*itr) < 100 || BT::key(*itr) >= 1900);
+    bt12.erase(bt12.begin(), bt12.end());
+    BOOST_TEST(bt12.empty());
+    BOOST_TEST_EQ(bt12.node_count(), 1U);
+    BOOST_TEST_EQ(bt12.height(), 0);
+
+    cout << "append test" << endl;
+
+    BT bt14(256);
+    STL stl14;
+    for (int i = 0; i < 2000; ++i)
+    {
+      bt14.insert(BT::make_value(i, i));
+      stl14.insert(BT::make_value(i, i));
+    }
+    BT bt15(stl14.begin(), stl14.end(), 256);
+    BOOST_TEST_EQ(bt14.node_count(), bt15.node_count());  // packed like a bulk load
+    BOOST_TEST_EQ(bt14.height(), bt15.height());
+    // keys that don't follow the last key still go to the right place
+    for (int i = 1999; i >= 0; i -= 7)
+    {
+      bt14.insert(BT::make_value(i, i));
+      stl14.insert(BT::make_value(i, i));
+    }
+    bt14.insert(BT::make_value(1999, 1999));  // equal to the last key
+    stl14.insert(BT::make_value(1999, 1999));
+    bt14.insert(BT::make_value(5000, 5000));
+    stl14.insert(BT::make_value(5000, 5000));
+    BOOST_TEST_EQ(bt14.size(), stl14.size());
+    BOOST_TEST(std::equal(bt14.begin(), bt14.end(), stl14.begin()));
+    for (int k = -1; k <= 2000; ++k)
+      BOOST_TEST_EQ(bt14.count(k), stl14.count(k));
+    BOOST_TEST_EQ(bt14.count(5000), 1U);
+
+    cout << "hint test" << endl;
+
+    BT bt16(256);
+    STL stl16;
+    for (int i = 0; i < 2000; i += 4)  // ascending, hinted by end()
+    {
+      itr = bt16.insert(bt16.end(), BT::make_value(i, i));
+      stl16.insert(stl16.end(), BT::make_value(i, i));
+      BOOST_TEST_EQ(BT::key(*itr), i);
+    }
+    BT bt17(stl16.begin(), stl16.end(), 256);
+    BOOST_TEST_EQ(bt16.node_count(), bt17.node_count());  // appended
+    // hinted by the following element, which is sometimes first on its leaf
+    for (int i = 2; i < 2000; i += 4)
+    {
+      itr = bt16.insert(bt16.find(i + 2 < 2000 ? i + 2 : 0), BT::make_value(i, i));
+      stl16.insert(stl16.find(i + 2 < 2000 ? i + 2 : 0), BT::make_value(i, i));
+      BOOST_TEST_EQ(BT::key(*itr), i);
+    }
+    // ascending runs, each hinted by the element following the one just inserted
+    itr = bt16.begin();
+    for (int i = 1; i < 2000; i += 2)
+    {
+      itr = bt16.emplace_hint(itr, BT::make_value(i, i));
+      stl16.emplace_hint(stl16.upper_bound(i), BT::make_value(i, i));
+      BOOST_TEST_EQ(BT::key(*itr), i);
+      ++itr;
+    }
+    // poor hints, and keys already present
+    for (int i = 2100; i >= -100; i -= 7)
+    {
+      itr = bt16.insert(bt16.begin(), BT::make_value(i, i));
+      stl16.insert(stl16.begin(), BT::make_value(i, i));
+      BOOST_TEST_EQ(BT::key(*itr), i);
+      itr = bt16.insert(bt16.end(), BT::make_value(i, i));
+      stl16.insert(stl16.end(), BT::make_value(i, i));
+      BOOST_TEST_EQ(BT::key(*itr), i);
+    }
+    BOOST_TEST_EQ(bt16.size(), stl16.size());
+    BOOST_TEST(std::equal(bt16.begin(), bt16.end(), stl16.begin()));
+    for (int k = -101; k <= 2101; ++k)
+      BOOST_TEST_EQ(bt16.count(k), stl16.count(k));
+
+    cout << "range erase test" << endl;
+
+    // ranges that span whole subtrees, start or end on a leaf boundary, or reach either
+    // end, each compared with the STL container
+    for (int size : {2000, 20000})
+    {
+      BT bt18(256);
+      STL stl18;
+      for (int i = 0; i < size; ++i)
+      {
+        bt18.insert(BT::make_value(i / 2, i));
+        stl18.insert(BT::make_value(i / 2, i));
+      }
+      std::size_t n = bt18.erase_before(size / 20);
+      BOOST_TEST_EQ(n, stl18.size() - bt18.size());
+      stl18.erase(stl18.begin(), stl18.lower_bound(size / 20));
+      n = bt18.erase_after(size / 2 - size / 20);
+      BOOST_TEST_EQ(n, stl18.size() - bt18.size());
+      stl18.erase(stl18.upper_bound(size / 2 - size / 20), stl18.end());
+      BOOST_TEST_EQ(bt18.size(), stl18.size());
+
+      for (int i = 1; !stl18.empty(); ++i)
+      {
+        std::size_t a = (i * 7919U) % stl18.size();
+        std::size_t n = std::min<std::size_t>((i * 104729U) % (stl18.size() / 2 + 2),
+          stl18.size() - a);
+        typename BT::iterator first = bt18.begin();
+        std::advance(first, a);
+        typename BT::iterator last = first;
+        std::advance(last, n);
+        typename STL::iterator sfirst = stl18.begin();
+        std::advance(sfirst, a);
+        typename STL::iterator slast = sfirst;
+        std::advance(slast, n);
+        itr = bt18.erase(first, last);
+        sfirst = stl18.erase(sfirst, slast);
+        BOOST_TEST(sfirst == stl18.end() ? itr == bt18.end() : *itr == *sfirst);
+        BOOST_TEST_EQ(bt18.size(), stl18.size());
+        BOOST_TEST(std::equal(bt18.begin(), bt18.end(), stl18.begin()));
+        for (int k = -1; k <= size / 2; k += 37)
+          BOOST_TEST_EQ(bt18.count(k), stl18.count(k));
+      }
+      BOOST_TEST_EQ(bt18.node_count(), 1U);
+    }
+
     cout << "clear test" << endl;
 
     bt.clear();
@@ -453,6 +1555,16 @@ namespace
 int cpp_main(int, char*[])
 {
   archetype_test();
+  allocator_test();
+  split_move_test();
+  simd_search_test();
+  branch_layout_test();
+  search_policy_test();
+  find_batch_test();
+  cursor_test();
+  order_statistics_test();
+  range_aggregate_test();
+  split_join_test();
 
   cout << "----------------- mbt_map test -----------------\n\n";
   test<btree::mbt_map<int, long>, std::map<int, long>, true_type, true_type>();